@@ -0,0 +1,254 @@
+#pragma once
+
+#include "pch.h"
+
+#include <sstream>
+#include <cmath>
+
+//collects startup step and frame times for one run and writes them as a flat json object
+//a previous results file can be loaded as a baseline, every metric is then compared against it
+class Benchmark
+{
+	public:
+		//a metric only counts as regressed when it is worse by this fraction and, for times, by at least MIN_REGRESSION_MS
+		static constexpr double DEFAULT_THRESHOLD = 0.10;
+		static constexpr double MIN_REGRESSION_MS = 0.25;
+
+		void beginStartup()
+		{
+			lastMark = std::chrono::steady_clock::now();
+		}
+
+		//charges the time since the previous mark to step, marks with the same name add up
+		void markStartup(const char* step)
+		{
+			auto now = std::chrono::steady_clock::now();
+			double elapsed = std::chrono::duration<double, std::milli>(now - lastMark).count();
+			lastMark = now;
+
+			for(auto& entry : startupSteps)
+			{
+				if(entry.first == step)
+				{
+					entry.second += elapsed;
+					return;
+				}
+			}
+			startupSteps.emplace_back(step, elapsed);
+		}
+
+		//a fixed value of the run like a buffer size, written next to the timings and compared as lower is better
+		void setValue(const std::string& name, double value)
+		{
+			for(auto& entry : values)
+			{
+				if(entry.first == name)
+				{
+					entry.second = value;
+					return;
+				}
+			}
+			values.emplace_back(name, value);
+		}
+
+		//frames before warmupFrames are counted in the fps but left out of the frame time percentiles
+		void beginFrames(uint64_t expectedFrames, uint64_t warmupFrames)
+		{
+			this->warmupFrames = warmupFrames;
+			frameTimes.clear();
+			frameTimes.reserve(static_cast<size_t>(expectedFrames));
+			framesStart = std::chrono::steady_clock::now();
+			lastFrame = framesStart;
+		}
+
+		void markFrame()
+		{
+			auto now = std::chrono::steady_clock::now();
+			frameTimes.push_back(std::chrono::duration<double, std::milli>(now - lastFrame).count());
+			lastFrame = now;
+		}
+
+		void endFrames()
+		{
+			framesSeconds = std::chrono::duration<double>(lastFrame - framesStart).count();
+		}
+
+		//metric name and value in the order they are written
+		std::vector<std::pair<std::string, double>> getMetrics() const
+		{
+			std::vector<std::pair<std::string, double>> metrics;
+
+			double startupTotal = 0.0;
+			for(auto& entry : startupSteps)
+			{
+				metrics.emplace_back("startup_ms_" + entry.first, entry.second);
+				startupTotal += entry.second;
+			}
+			metrics.emplace_back("startup_ms_total", startupTotal);
+			for(auto& entry : values)
+			{
+				metrics.push_back(entry);
+			}
+
+			std::vector<double> sorted;
+			if(frameTimes.size() > warmupFrames)
+			{
+				sorted.assign(frameTimes.begin() + static_cast<ptrdiff_t>(warmupFrames), frameTimes.end());
+			}
+			else
+			{
+				sorted = frameTimes;
+			}
+			std::sort(sorted.begin(), sorted.end());
+
+			double sum = 0.0;
+			for(double time : sorted)
+			{
+				sum += time;
+			}
+
+			metrics.emplace_back("frames", static_cast<double>(frameTimes.size()));
+			metrics.emplace_back("fps", framesSeconds > 0.0 ? frameTimes.size() / framesSeconds : 0.0);
+			metrics.emplace_back("frame_ms_mean", sorted.empty() ? 0.0 : sum / sorted.size());
+			metrics.emplace_back("frame_ms_p50", percentile(sorted, 0.50));
+			metrics.emplace_back("frame_ms_p95", percentile(sorted, 0.95));
+			metrics.emplace_back("frame_ms_p99", percentile(sorted, 0.99));
+			metrics.emplace_back("frame_ms_max", sorted.empty() ? 0.0 : sorted.back());
+			return metrics;
+		}
+
+		void printSummary(std::ostream& out) const
+		{
+			auto metrics = getMetrics();
+			out << "benchmark:\n";
+			for(auto& metric : metrics)
+			{
+				out << "\t  " << metric.first << ": " << metric.second << "\n";
+			}
+		}
+
+		void writeResults(const std::string& path, const std::string& label) const
+		{
+			std::ofstream file(path);
+			if(!file.is_open())
+			{
+				throw std::runtime_error("failed to open " + path + "!");
+			}
+
+			file << "{\n\t\"label\": \"" << label << "\"";
+			for(auto& metric : getMetrics())
+			{
+				file << ",\n\t\"" << metric.first << "\": " << metric.second;
+			}
+			file << "\n}\n";
+		}
+
+		//prints every metric next to its baseline value and returns how many regressed
+		//fps is better when higher, everything else is a time or a size and better when lower
+		uint32_t compareToBaseline(const std::string& path, double threshold, std::ostream& out) const
+		{
+			std::map<std::string, double> baseline = readResults(path);
+			uint32_t regressions = 0;
+
+			out << "benchmark against " << path << ":\n";
+			for(auto& metric : getMetrics())
+			{
+				auto found = baseline.find(metric.first);
+				if(found == baseline.end() || metric.first == "frames")
+				{
+					continue;
+				}
+
+				double base = found->second;
+				double current = metric.second;
+				bool higherIsBetter = metric.first == "fps";
+				double change = base != 0.0 ? (current - base) / base : 0.0;
+
+				bool regressed;
+				if(higherIsBetter)
+				{
+					regressed = current < base * (1.0 - threshold);
+				}
+				else
+				{
+					regressed = current > base * (1.0 + threshold) && current - base >= MIN_REGRESSION_MS;
+				}
+
+				out << "\t  " << metric.first << ": " << current << " (baseline " << base << ", " << (change >= 0.0 ? "+" : "") << change * 100.0 << "%)" << (regressed ? " REGRESSED" : "") << "\n";
+				if(regressed)
+				{
+					regressions++;
+				}
+			}
+			return regressions;
+		}
+
+	private:
+		std::chrono::steady_clock::time_point lastMark;
+		std::vector<std::pair<std::string, double>> startupSteps;
+		std::vector<std::pair<std::string, double>> values;
+
+		std::chrono::steady_clock::time_point framesStart;
+		std::chrono::steady_clock::time_point lastFrame;
+		std::vector<double> frameTimes;
+		uint64_t warmupFrames = 0;
+		double framesSeconds = 0.0;
+
+		//nearest rank on already sorted values
+		static double percentile(const std::vector<double>& sorted, double fraction)
+		{
+			if(sorted.empty())
+			{
+				return 0.0;
+			}
+			size_t rank = static_cast<size_t>(std::ceil(fraction * sorted.size()));
+			return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+		}
+
+		//only understands the flat "name": number objects writeResults produces, other values are skipped
+		static std::map<std::string, double> readResults(const std::string& path)
+		{
+			std::ifstream file(path);
+			if(!file.is_open())
+			{
+				throw std::runtime_error("failed to open " + path + "!");
+			}
+			std::stringstream contents;
+			contents << file.rdbuf();
+			std::string text = contents.str();
+
+			std::map<std::string, double> values;
+			size_t position = 0;
+			while((position = text.find('"', position)) != std::string::npos)
+			{
+				size_t nameEnd = text.find('"', position + 1);
+				size_t colon = text.find(':', nameEnd);
+				if(nameEnd == std::string::npos || colon == std::string::npos)
+				{
+					break;
+				}
+				std::string name = text.substr(position + 1, nameEnd - position - 1);
+
+				size_t valueStart = text.find_first_not_of(" \t\r\n", colon + 1);
+				if(valueStart != std::string::npos && text[valueStart] == '"')
+				{
+					//string value, skip past its closing quote
+					position = text.find('"', valueStart + 1) + 1;
+					if(position == 0)
+					{
+						break;
+					}
+					continue;
+				}
+
+				char* end = nullptr;
+				double value = std::strtod(text.c_str() + colon + 1, &end);
+				if(end != text.c_str() + colon + 1)
+				{
+					values[name] = value;
+				}
+				position = colon + 1;
+			}
+			return values;
+		}
+};
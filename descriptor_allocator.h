@@ -0,0 +1,304 @@
+#pragma once
+
+#include "pch.h"
+
+#include <vulkan/vulkan.h>
+
+#include <unordered_map>
+
+struct DescriptorAllocatorStats
+{
+	uint64_t setAllocationCount = 0;
+	uint64_t allocateCallCount = 0; //vkAllocateDescriptorSets calls, including the ones that ran out of pool memory
+	uint32_t poolCount = 0;
+	uint64_t poolGrowCount = 0; //times a full pool was replaced by another one
+	uint64_t resetCount = 0;
+	double allocationTime = 0.0; //ms spent in allocate, including pool creation
+};
+
+//descriptors of one type a pool holds per set it is sized for
+struct DescriptorPoolRatio
+{
+	VkDescriptorType type;
+	float descriptorsPerSet;
+};
+
+//allocates descriptor sets from a chain of pools instead of one pool sized up front
+//when the current pool runs out a free one is taken or a new one twice the size of the last is created
+//reset() hands every pool back at once, which suits sets that only live for one frame
+class DescriptorAllocator
+{
+	public:
+		static const uint32_t DEFAULT_SETS_PER_POOL = 16;
+		static const uint32_t MAX_SETS_PER_POOL = 4096;
+
+		void init(VkDevice device, std::vector<DescriptorPoolRatio> ratios, uint32_t setsPerPool = DEFAULT_SETS_PER_POOL, VkDescriptorPoolCreateFlags flags = 0)
+		{
+			this->device = device;
+			this->ratios = std::move(ratios);
+			this->setsPerPool = setsPerPool;
+			this->flags = flags;
+		}
+
+		void destroy()
+		{
+			for(VkDescriptorPool pool : usedPools)
+			{
+				vkDestroyDescriptorPool(device, pool, nullptr);
+			}
+			for(VkDescriptorPool pool : freePools)
+			{
+				vkDestroyDescriptorPool(device, pool, nullptr);
+			}
+			usedPools.clear();
+			freePools.clear();
+			currentPool = VK_NULL_HANDLE;
+		}
+
+		//fills sets with one set per layout, all from the same pool
+		void allocate(const std::vector<VkDescriptorSetLayout>& layouts, VkDescriptorSet* sets)
+		{
+			auto start = std::chrono::steady_clock::now();
+
+			if(currentPool == VK_NULL_HANDLE)
+			{
+				currentPool = grabPool();
+			}
+
+			VkDescriptorSetAllocateInfo allocInfo = {};
+			allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+			allocInfo.descriptorPool = currentPool;
+			allocInfo.descriptorSetCount = static_cast<uint32_t>(layouts.size());
+			allocInfo.pSetLayouts = layouts.data();
+
+			VkResult result = vkAllocateDescriptorSets(device, &allocInfo, sets);
+			stats.allocateCallCount++;
+			if(result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL)
+			{
+				currentPool = grabPool();
+				stats.poolGrowCount++;
+
+				allocInfo.descriptorPool = currentPool;
+				result = vkAllocateDescriptorSets(device, &allocInfo, sets);
+				stats.allocateCallCount++;
+			}
+			if(result != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to allocate descriptor sets!");
+			}
+
+			stats.setAllocationCount += layouts.size();
+			stats.allocationTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+
+		VkDescriptorSet allocate(VkDescriptorSetLayout layout)
+		{
+			VkDescriptorSet set;
+			allocate(std::vector<VkDescriptorSetLayout>{layout}, &set);
+			return set;
+		}
+
+		//frees every set allocated so far, the caller makes sure the gpu no longer uses them
+		void reset()
+		{
+			if(currentPool == VK_NULL_HANDLE)
+			{
+				return;
+			}
+
+			for(VkDescriptorPool pool : usedPools)
+			{
+				vkResetDescriptorPool(device, pool, 0);
+				freePools.push_back(pool);
+			}
+			usedPools.clear();
+			currentPool = VK_NULL_HANDLE;
+			stats.resetCount++;
+		}
+
+		const DescriptorAllocatorStats& getStats() const
+		{
+			return stats;
+		}
+
+		void printStats(std::ostream& out, const char* name) const
+		{
+			out << "descriptor allocator " << name << ":\n";
+			out << "\t  sets: " << stats.setAllocationCount << " in " << stats.allocationTime << " ms, vkAllocateDescriptorSets calls: " << stats.allocateCallCount << "\n";
+			out << "\t  pools: " << stats.poolCount << ", grown: " << stats.poolGrowCount << ", resets: " << stats.resetCount << "\n";
+		}
+
+	private:
+		VkDevice device = VK_NULL_HANDLE;
+		std::vector<DescriptorPoolRatio> ratios;
+		uint32_t setsPerPool = DEFAULT_SETS_PER_POOL;
+		VkDescriptorPoolCreateFlags flags = 0;
+
+		VkDescriptorPool currentPool = VK_NULL_HANDLE;
+		std::vector<VkDescriptorPool> usedPools;
+		std::vector<VkDescriptorPool> freePools;
+		DescriptorAllocatorStats stats;
+
+		VkDescriptorPool grabPool()
+		{
+			VkDescriptorPool pool;
+			if(!freePools.empty())
+			{
+				pool = freePools.back();
+				freePools.pop_back();
+			}
+			else
+			{
+				pool = createPool(setsPerPool);
+				setsPerPool = std::min(setsPerPool * 2, MAX_SETS_PER_POOL);
+			}
+			usedPools.push_back(pool);
+			return pool;
+		}
+
+		VkDescriptorPool createPool(uint32_t maxSets)
+		{
+			std::vector<VkDescriptorPoolSize> poolSizes;
+			for(const DescriptorPoolRatio& ratio : ratios)
+			{
+				VkDescriptorPoolSize poolSize = {};
+				poolSize.type = ratio.type;
+				poolSize.descriptorCount = std::max(1u, static_cast<uint32_t>(ratio.descriptorsPerSet * maxSets));
+				poolSizes.push_back(poolSize);
+			}
+
+			VkDescriptorPoolCreateInfo poolInfo = {};
+			poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+			poolInfo.flags = flags;
+			poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+			poolInfo.pPoolSizes = poolSizes.data();
+			poolInfo.maxSets = maxSets;
+
+			VkDescriptorPool pool;
+			if(vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create descriptor pool!");
+			}
+			stats.poolCount++;
+			return pool;
+		}
+};
+
+//creates every descriptor set layout once, asking for the same bindings again returns the existing layout
+//bindings are sorted by binding number before hashing so their order does not matter, immutable samplers are compared by pointer
+class DescriptorLayoutCache
+{
+	public:
+		void init(VkDevice device)
+		{
+			this->device = device;
+		}
+
+		void destroy()
+		{
+			for(auto& entry : layouts)
+			{
+				vkDestroyDescriptorSetLayout(device, entry.second, nullptr);
+			}
+			layouts.clear();
+		}
+
+		//bindingFlags is either empty or has one entry per binding, in the order of bindings
+		VkDescriptorSetLayout getLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings, const std::vector<VkDescriptorBindingFlags>& bindingFlags = {}, VkDescriptorSetLayoutCreateFlags flags = 0)
+		{
+			LayoutKey key;
+			key.flags = flags;
+			std::vector<size_t> order(bindings.size());
+			for(size_t i = 0; i < order.size(); i++)
+			{
+				order[i] = i;
+			}
+			std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return bindings[a].binding < bindings[b].binding; });
+			for(size_t i : order)
+			{
+				key.bindings.push_back(bindings[i]);
+				key.bindingFlags.push_back(bindingFlags.empty() ? 0 : bindingFlags[i]);
+			}
+
+			auto found = layouts.find(key);
+			if(found != layouts.end())
+			{
+				hitCount++;
+				return found->second;
+			}
+
+			VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo = {};
+			bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+			bindingFlagsInfo.bindingCount = static_cast<uint32_t>(key.bindingFlags.size());
+			bindingFlagsInfo.pBindingFlags = key.bindingFlags.data();
+
+			VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+			layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+			layoutInfo.pNext = bindingFlags.empty() ? nullptr : &bindingFlagsInfo;
+			layoutInfo.flags = flags;
+			layoutInfo.bindingCount = static_cast<uint32_t>(key.bindings.size());
+			layoutInfo.pBindings = key.bindings.data();
+
+			VkDescriptorSetLayout layout;
+			if(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &layout) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create descriptor layout!");
+			}
+			layouts.emplace(std::move(key), layout);
+			return layout;
+		}
+
+		void printStats(std::ostream& out) const
+		{
+			out << "descriptor layout cache: " << layouts.size() << " layouts, " << hitCount << " hits\n";
+		}
+
+	private:
+		struct LayoutKey
+		{
+			VkDescriptorSetLayoutCreateFlags flags = 0;
+			std::vector<VkDescriptorSetLayoutBinding> bindings;
+			std::vector<VkDescriptorBindingFlags> bindingFlags;
+
+			bool operator==(const LayoutKey& other) const
+			{
+				if(flags != other.flags || bindings.size() != other.bindings.size() || bindingFlags != other.bindingFlags)
+				{
+					return false;
+				}
+				for(size_t i = 0; i < bindings.size(); i++)
+				{
+					const VkDescriptorSetLayoutBinding& a = bindings[i];
+					const VkDescriptorSetLayoutBinding& b = other.bindings[i];
+					if(a.binding != b.binding || a.descriptorType != b.descriptorType || a.descriptorCount != b.descriptorCount || a.stageFlags != b.stageFlags || a.pImmutableSamplers != b.pImmutableSamplers)
+					{
+						return false;
+					}
+				}
+				return true;
+			}
+		};
+
+		struct LayoutKeyHash
+		{
+			size_t operator()(const LayoutKey& key) const
+			{
+				size_t hash = std::hash<uint32_t>()(key.flags);
+				auto combine = [&hash](size_t value) { hash ^= value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2); };
+				for(size_t i = 0; i < key.bindings.size(); i++)
+				{
+					const VkDescriptorSetLayoutBinding& binding = key.bindings[i];
+					combine(binding.binding);
+					combine(static_cast<size_t>(binding.descriptorType));
+					combine(binding.descriptorCount);
+					combine(binding.stageFlags);
+					combine(key.bindingFlags[i]);
+				}
+				return hash;
+			}
+		};
+
+		VkDevice device = VK_NULL_HANDLE;
+		std::unordered_map<LayoutKey, VkDescriptorSetLayout, LayoutKeyHash> layouts;
+		uint64_t hitCount = 0;
+};
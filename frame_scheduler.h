@@ -0,0 +1,133 @@
+#pragma once
+
+#include "pch.h"
+
+#include <vulkan/vulkan.h>
+
+struct FrameSchedulerStats
+{
+	uint64_t slotWaitCount = 0; //frames that had to block until an earlier frame completed
+	double slotWaitTime = 0.0; //ms
+	uint64_t counterQueryCount = 0;
+};
+
+//paces the cpu against the gpu with one timeline semaphore instead of a fence per frame in flight
+//frame n signals value n + 1 once its commands have completed, so the counter is the number of completed frames
+//other subsystems ask it which frames have completed to know when per frame resources can be reused or destroyed
+class FrameScheduler
+{
+	public:
+		void init(VkDevice device, uint32_t framesInFlight)
+		{
+			this->device = device;
+			this->framesInFlight = framesInFlight;
+
+			VkSemaphoreTypeCreateInfo typeInfo = {};
+			typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+			typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+			typeInfo.initialValue = 0;
+
+			VkSemaphoreCreateInfo semaphoreInfo = {};
+			semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+			semaphoreInfo.pNext = &typeInfo;
+
+			if(vkCreateSemaphore(device, &semaphoreInfo, nullptr, &timeline) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create frame timeline semaphore!");
+			}
+		}
+
+		//takes effect from the next waitForSlot, the caller keeps enough per frame slots for the new depth
+		void setFramesInFlight(uint32_t framesInFlight)
+		{
+			this->framesInFlight = framesInFlight;
+		}
+
+		void destroy()
+		{
+			vkDestroySemaphore(device, timeline, nullptr);
+		}
+
+		//blocks until frameNumber's slot is no longer used by the frame framesInFlight before it
+		void waitForSlot(uint64_t frameNumber)
+		{
+			if(frameNumber >= framesInFlight)
+			{
+				waitForFrame(frameNumber - framesInFlight);
+			}
+		}
+
+		//only queries the semaphore when the last value seen is not far enough yet
+		bool isFrameComplete(uint64_t frameNumber)
+		{
+			if(completedFrames > frameNumber)
+			{
+				return true;
+			}
+			return getCompletedFrameCount() > frameNumber;
+		}
+
+		void waitForFrame(uint64_t frameNumber)
+		{
+			if(isFrameComplete(frameNumber))
+			{
+				return;
+			}
+
+			auto start = std::chrono::steady_clock::now();
+			uint64_t value = frameNumber + 1;
+			VkSemaphoreWaitInfo waitInfo = {};
+			waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+			waitInfo.semaphoreCount = 1;
+			waitInfo.pSemaphores = &timeline;
+			waitInfo.pValues = &value;
+			if(vkWaitSemaphores(device, &waitInfo, UINT64_MAX) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to wait for frame timeline semaphore!");
+			}
+			completedFrames = std::max(completedFrames, value);
+
+			stats.slotWaitCount++;
+			stats.slotWaitTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+
+		//frames 0 to the returned count - 1 have completed on the gpu
+		uint64_t getCompletedFrameCount()
+		{
+			if(vkGetSemaphoreCounterValue(device, timeline, &completedFrames) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to query frame timeline semaphore!");
+			}
+			stats.counterQueryCount++;
+			return completedFrames;
+		}
+
+		VkSemaphore getSemaphore() const
+		{
+			return timeline;
+		}
+
+		//the value frameNumber's submit signals
+		uint64_t getSignalValue(uint64_t frameNumber) const
+		{
+			return frameNumber + 1;
+		}
+
+		uint32_t getFramesInFlight() const
+		{
+			return framesInFlight;
+		}
+
+		void printStats(std::ostream& out) const
+		{
+			out << "frame scheduler (" << framesInFlight << " frames in flight):\n";
+			out << "\t  blocking waits: " << stats.slotWaitCount << " for " << stats.slotWaitTime << " ms, counter queries: " << stats.counterQueryCount << "\n";
+		}
+
+	private:
+		VkDevice device = VK_NULL_HANDLE;
+		VkSemaphore timeline = VK_NULL_HANDLE;
+		uint32_t framesInFlight = 2;
+		uint64_t completedFrames = 0;
+		FrameSchedulerStats stats;
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "pch.h"
+
+//number of levels in a full mip chain down to 1x1
+inline uint32_t mipLevelCount(uint32_t width, uint32_t height)
+{
+	uint32_t levels = 1;
+	while((std::max(width, height) >> levels) > 0)
+	{
+		levels++;
+	}
+	return levels;
+}
+
+//bytes of a tightly packed chain of mipLevels levels, each level half the size of the previous one rounded down
+inline size_t mipChainSize(uint32_t width, uint32_t height, uint32_t mipLevels, size_t texelSize)
+{
+	size_t size = 0;
+	for(uint32_t level = 0; level < mipLevels; level++)
+	{
+		size += static_cast<size_t>(std::max(width >> level, 1u)) * std::max(height >> level, 1u) * texelSize;
+	}
+	return size;
+}
+
+//rounded average of four rgba8 texels, the channels are split into two 16 bit lanes per word so one add covers two channels
+inline uint32_t averageRGBA8(uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+{
+	const uint32_t mask = 0x00ff00ffu;
+	uint32_t evenChannels = (a & mask) + (b & mask) + (c & mask) + (d & mask) + 0x00020002u;
+	uint32_t oddChannels = ((a >> 8) & mask) + ((b >> 8) & mask) + ((c >> 8) & mask) + ((d >> 8) & mask) + 0x00020002u;
+	return ((evenChannels >> 2) & mask) | (((oddChannels >> 2) & mask) << 8);
+}
+
+//box filters one rgba8 level into the next, an odd last row or column is dropped and a side of 1 is repeated
+inline void downsampleRGBA8(const uint32_t* src, uint32_t srcWidth, uint32_t srcHeight, uint32_t* dst)
+{
+	uint32_t dstWidth = std::max(srcWidth / 2, 1u);
+	uint32_t dstHeight = std::max(srcHeight / 2, 1u);
+
+	for(uint32_t y = 0; y < dstHeight; y++)
+	{
+		const uint32_t* row0 = src + static_cast<size_t>(std::min(y * 2, srcHeight - 1)) * srcWidth;
+		const uint32_t* row1 = src + static_cast<size_t>(std::min(y * 2 + 1, srcHeight - 1)) * srcWidth;
+		uint32_t* out = dst + static_cast<size_t>(y) * dstWidth;
+
+		//branch free over the even part of the row so the compiler can vectorise it
+		uint32_t pairs = srcWidth / 2;
+		for(uint32_t x = 0; x < pairs; x++)
+		{
+			out[x] = averageRGBA8(row0[x * 2], row0[x * 2 + 1], row1[x * 2], row1[x * 2 + 1]);
+		}
+		if(pairs == 0)
+		{
+			out[0] = averageRGBA8(row0[0], row0[0], row1[0], row1[0]);
+		}
+	}
+}
+
+//builds the full mip chain of an rgba8 image on the cpu, used when the gpu cannot blit the format with linear filtering
+//returns mip 0 followed by every smaller level, laid out as UploadEngine::uploadImageMipChain expects
+inline std::vector<uint8_t> buildMipChainRGBA8(const uint8_t* pixels, uint32_t width, uint32_t height)
+{
+	uint32_t mipLevels = mipLevelCount(width, height);
+	std::vector<uint8_t> chain(mipChainSize(width, height, mipLevels, 4));
+	memcpy(chain.data(), pixels, static_cast<size_t>(width) * height * 4);
+
+	uint8_t* level = chain.data();
+	uint32_t levelWidth = width;
+	uint32_t levelHeight = height;
+	for(uint32_t i = 1; i < mipLevels; i++)
+	{
+		uint8_t* next = level + static_cast<size_t>(levelWidth) * levelHeight * 4;
+		downsampleRGBA8(reinterpret_cast<const uint32_t*>(level), levelWidth, levelHeight, reinterpret_cast<uint32_t*>(next));
+
+		level = next;
+		levelWidth = std::max(levelWidth / 2, 1u);
+		levelHeight = std::max(levelHeight / 2, 1u);
+	}
+	return chain;
+}
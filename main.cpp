@@ -8,13 +8,26 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 #define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
 //indernal dependancies
-
+#include "memory_allocator.h"
+#include "upload_engine.h"
+#include "thread_pool.h"
+#include "profiler.h"
+#include "benchmark.h"
+#include "mesh_format.h"
+#include "image_mips.h"
+#include "texture_format.h"
+#include "texture_loader.h"
+#include "descriptor_allocator.h"
+#include "frame_scheduler.h"
+#include "present_profile.h"
+#include "vertex_layout.h"
 
 //memory tracking
 #if (TRACK_MEM_ALLOC)
@@ -44,6 +57,8 @@ void operator delete(void* memory, size_t size)
 #endif
 
 const bool debug_log = false;
+//prints performance statistics (allocator usage, timings) on exit
+const bool stats_log = true;
 
 const int WIDTH = 800;
 const int HEIGHT = 600;
@@ -56,8 +71,33 @@ const bool enableValidationLayers = true;
 const bool enableValidationLayers = false;
 #endif
 const std::vector<const char*> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+//enabled when the device supports them, features depending on them check the matching flag
+const std::vector<const char*> optionalDeviceExtensions = {VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME};
+
+const std::string PIPELINE_CACHE_FILE = "pipeline_cache.bin";
+
+//upper bound of --frames-in-flight
+const uint32_t MAX_FRAMES_IN_FLIGHT = 4;
+
+//size of the persistently mapped uniform buffer each frame in flight sub allocates its constants from
+const VkDeviceSize UNIFORM_RING_SIZE = 1024 * 1024;
 
-const int MAX_FRAMES_IN_FLIGHT = 2;
+//persistently mapped staging memory shared by all uploads, bigger assets are streamed through it in chunks
+const VkDeviceSize STAGING_RING_SIZE = 4 * 1024 * 1024;
+
+//default number of mesh instances, see --instances
+const uint32_t SCENE_OBJECT_COUNT = 1;
+
+//threads recording scene draws besides the main thread, 0 uses one per core
+const uint32_t RECORD_THREAD_COUNT = 0;
+//every recording task adds one instanced draw per submesh, so the instances are only split up for very large scenes
+const uint32_t MIN_INSTANCES_PER_RECORDING_TASK = 16384;
+//instance transforms are written by the worker threads in batches of this size
+const uint32_t INSTANCE_UPDATE_BATCH = 4096;
+//must match local_size_x in shaders/cull.comp
+const uint32_t CULL_WORKGROUP_SIZE = 64;
+//upper bound of the bindless texture table, slot 0 always holds the placeholder
+const uint32_t MAX_BINDLESS_TEXTURES = 4096;
 
 VkResult CreateDebugUtilsMessengerEXT(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkDebugUtilsMessengerEXT* pDebugMessenger)
 {
@@ -85,14 +125,64 @@ void DestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMessengerEXT
 	}
 }
 
+//command line options, see parseOptions
+struct ApplicationOptions
+{
+	//render into offscreen images without a window, surface or swapchain
+	bool headless = false;
+	//stop after this many frames, 0 runs until the window is closed
+	uint64_t frameCount = 0;
+	//stop after this many seconds of rendering, 0 has no time limit
+	double durationSeconds = 0.0;
+	//frames the cpu may record ahead of the gpu, fewer lowers latency and more smooths out frame time spikes
+	uint32_t framesInFlight = 2;
+	//present mode, swapchain depth, frames in flight and frame limit, see present_profile.h
+	PresentProfile presentProfile = PRESENT_PROFILE_DEFAULT;
+	//mesh file written by tools/meshconv, the built in quad is drawn when empty
+	std::string meshPath;
+	uint32_t instanceCount = SCENE_OBJECT_COUNT;
+	//frustum cull the instances in a compute pass and draw the survivors indirectly
+	bool gpuCulling = false;
+	//lay down depth in a subpass of its own first so the fragment shader only runs for visible fragments
+	bool depthPrepass = false;
+	//count fragment shader invocations with pipeline statistics queries to measure overdraw
+	bool pipelineStatistics = false;
+	//samples per pixel, lowered to the highest count the device supports for both colour and depth attachments
+	uint32_t msaaSamples = 1;
+	//how the vertices are stored on the gpu, see vertex_layout.h
+	VertexLayoutPreset vertexLayout = VERTEX_LAYOUT_FLOAT;
+	//a .ktx2 file written by tools/texconv is uploaded as stored, anything else is decoded with stb_image
+	//the instances cycle through the textures, without bindless textures only the first one is drawn
+	std::vector<std::string> texturePaths;
+	//sample every texture through one descriptor indexed table when the device supports it
+	bool bindless = true;
+	//how the texture's mip chain is built: gpu blits (falling back to cpu when the format cannot be blitted), cpu or off
+	std::string mipMode = "gpu";
+	//when set every readbackInterval-th frame is copied back and written to <readbackPath>_<frame>.ppm
+	std::string readbackPath;
+	uint32_t readbackInterval = 1;
+	//frame profile history written on exit, format is csv, json or chrome
+	std::string profileOutPath;
+	std::string profileFormat = "json";
+	//benchmark results are only collected when benchOutPath is set
+	std::string benchOutPath;
+	std::string benchBaselinePath;
+	double benchThreshold = Benchmark::DEFAULT_THRESHOLD;
+	uint64_t benchWarmupFrames = 10;
+};
+
 struct QueueFamilyIndicies
 {
 	std::optional<uint32_t> graphicsFamily;
 	std::optional<uint32_t> presentFamily;
+	//only set for a family without graphics or compute, those map to the gpu's copy engines
+	std::optional<uint32_t> transferFamily;
+	//false when rendering headless, there is no surface to present to
+	bool presentRequired = true;
 
 	bool isComplete()
 	{
-		return graphicsFamily.has_value() && presentFamily.has_value();
+		return graphicsFamily.has_value() && (presentFamily.has_value() || !presentRequired);
 	}
 };
 
@@ -103,6 +193,41 @@ struct SwapChainSupportDetails
 	std::vector<VkPresentModeKHR> presentModes;
 };
 
+//a swapchain replaced by a resize, destroyed once every frame that could still reference it has finished
+struct RetiredSwapChain
+{
+	VkSwapchainKHR swapChain;
+	std::vector<VkImageView> imageViews;
+	std::vector<VkFramebuffer> framebuffers;
+	VkImage depthImage;
+	Allocation depthImageAllocation;
+	VkImageView depthImageView;
+	VkImage colorImage;
+	Allocation colorImageAllocation;
+	VkImageView colorImageView;
+	//first frame that no longer renders to the swapchain, every frame before it has to complete before it is destroyed
+	uint64_t retiredFrame;
+};
+
+//command pool owned by one recording worker for one frame in flight, its secondary buffers are reused after each reset
+struct RecordingPool
+{
+	VkCommandPool pool;
+	std::vector<VkCommandBuffer> buffers;
+	uint32_t used = 0;
+};
+
+//what one frame in flight's secondary command buffers were recorded against, they are reused while it still matches
+struct RecordedDraws
+{
+	bool valid = false;
+	uint64_t sceneVersion = 0;
+	uint32_t uniformOffset = 0;
+	std::vector<VkCommandBuffer> commandBuffers;
+	//depth pre-pass draws executed in subpass 0, empty without --depth-prepass
+	std::vector<VkCommandBuffer> prepassCommandBuffers;
+};
+
 static std::vector<char> readFile(const std::string& filename)
 {
 	std::ifstream file(filename, std::ios::ate | std::ios::binary);
@@ -123,72 +248,144 @@ static std::vector<char> readFile(const std::string& filename)
 
 struct Vertex
 {
-	glm::vec2 pos;
+	glm::vec3 pos;
 	glm::vec3 color;
 	glm::vec2 texCoord;
+};
+
+const std::vector<Vertex> vertecies = 
+{
+	{{-0.5f, -0.5f, 0.0f}, {1.0f, 0.0f, 0.0f}, {1.0f, 0.0f}},
+	{{ 0.5f, -0.5f, 0.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f}},
+	{{ 0.5f,  0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 1.0f}},
+	{{-0.5f,  0.5f, 0.0f}, {1.0f, 1.0f, 1.0f}, {1.0f, 1.0f}}
+};
+
+const std::vector<uint16_t> indicies = { 0, 1, 2, 2, 3, 0 };
+
+//the mesh file's vertex layout has to match Vertex exactly, the converter always writes it this way
+//what the gpu gets is decided by the VertexLayout, which packs from this layout
+static bool meshMatchesVertexLayout(const MappedMesh& mesh)
+{
+	const MeshAttribute* position = mesh.findAttribute(MESH_SEMANTIC_POSITION);
+	const MeshAttribute* color = mesh.findAttribute(MESH_SEMANTIC_COLOR);
+	const MeshAttribute* texCoord = mesh.findAttribute(MESH_SEMANTIC_TEXCOORD);
+
+	return mesh.header().vertexStride == sizeof(Vertex)
+		&& position != nullptr && position->format == MESH_FORMAT_FLOAT3 && position->offset == offsetof(Vertex, pos)
+		&& color != nullptr && color->format == MESH_FORMAT_FLOAT3 && color->offset == offsetof(Vertex, color)
+		&& texCoord != nullptr && texCoord->format == MESH_FORMAT_FLOAT2 && texCoord->offset == offsetof(Vertex, texCoord);
+}
+
+//written once per frame, the per draw transform comes from DrawPushConstants instead
+struct UniformBufferObject
+{
+	alignas(16) glm::mat4 view;
+	alignas(16) glm::mat4 proj;
+	//every instance spins about its own z axis by this angle in radians
+	float spin;
+};
+
+//recorded into the draw command buffers with vkCmdPushConstants, so nothing per draw lives in device memory
+struct DrawPushConstants
+{
+	//centres and scales the mesh to fit a unit cube
+	alignas(16) glm::mat4 model;
+};
+
+//one element of the per frame instance storage buffer, indexed with gl_InstanceIndex
+//only rewritten when the scene changes so an unchanged scene costs no per object cpu time
+struct InstanceData
+{
+	alignas(16) glm::mat4 model;
+	alignas(16) glm::vec4 tint;
+	//slot in the bindless texture table
+	uint32_t textureIndex;
+};
+
+//inputs of shaders/cull.comp, the bounding sphere is in the space the instance transforms map to the world
+struct CullUniforms
+{
+	alignas(16) glm::vec4 frustumPlanes[6];
+	alignas(16) glm::vec4 boundingSphere;
+	uint32_t instanceCount;
+};
 
-	static VkVertexInputBindingDescription getBindingDescription()
+//linear allocator over one persistently mapped buffer per frame in flight
+//rewound when its frame comes around again, blocks are bound with dynamic offsets
+struct UniformRing
+{
+	VkBuffer buffer = VK_NULL_HANDLE;
+	Allocation allocation;
+	VkDeviceSize capacity = 0;
+	VkDeviceSize alignment = 1;
+	VkDeviceSize head = 0;
+	VkDeviceSize peak = 0;
+
+	uint32_t push(const void* data, VkDeviceSize size)
 	{
-		VkVertexInputBindingDescription bindingDescription;
-		bindingDescription.binding = 0;
-		bindingDescription.stride = sizeof(Vertex);
-		bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+		VkDeviceSize offset = (head + alignment - 1) & ~(alignment - 1);
+		if(offset + size > capacity)
+		{
+			throw std::runtime_error("uniform ring buffer overflow!");
+		}
 
-		return bindingDescription;
+		memcpy(static_cast<char*>(allocation.mapped) + offset, data, static_cast<size_t>(size));
+		head = offset + size;
+		peak = std::max(peak, head);
+
+		return static_cast<uint32_t>(offset);
 	}
 
-	static std::array<VkVertexInputAttributeDescription, 3> getAttributeDescription()
+	void reset()
 	{
-		std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions = {};
-		attributeDescriptions[0].binding = 0;
-		attributeDescriptions[0].location = 0;
-		attributeDescriptions[0].format = VK_FORMAT_R32G32_SFLOAT;
-		attributeDescriptions[0].offset = offsetof(Vertex, pos);
-
-		attributeDescriptions[1].binding = 0;
-		attributeDescriptions[1].location = 1;
-		attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-		attributeDescriptions[1].offset = offsetof(Vertex, color);
-
-		attributeDescriptions[2].binding = 0;
-		attributeDescriptions[2].location = 2;
-		attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
-		attributeDescriptions[2].offset = offsetof(Vertex, texCoord);
-
-		return attributeDescriptions;
+		head = 0;
 	}
 };
 
-const std::vector<Vertex> vertecies = 
+struct SceneObject
 {
-	{{-0.5f, -0.5f}, {1.0f, 0.0f, 0.0f}, {1.0f, 0.0f}},
-	{{ 0.5f, -0.5f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f}},
-	{{ 0.5f,  0.5f}, {0.0f, 0.0f, 1.0f}, {0.0f, 1.0f}},
-	{{-0.5f,  0.5f}, {1.0f, 1.0f, 1.0f}, {1.0f, 1.0f}}
+	glm::vec3 position;
+	glm::vec4 tint;
+	//index into options.texturePaths
+	uint32_t texture;
 };
 
-const std::vector<uint16_t> indicies = { 0, 1, 2, 2, 3, 0 };
-
-struct UniformBufferObject
+//one requested texture, sampled once its upload has completed
+struct LoadedTexture
 {
-	alignas(16) glm::mat4 model;
-	alignas(16) glm::mat4 view;
-	alignas(16) glm::mat4 proj;
+	VkImage image = VK_NULL_HANDLE;
+	Allocation allocation;
+	VkImageView view = VK_NULL_HANDLE;
+	uint32_t mipLevels = 1;
+	bool resident = false;
 };
 
 class HelloTringleApplication
 {
 	public:
-		void run()
+		void run(const ApplicationOptions& options)
 		{
-			initWindow();
+			this->options = options;
+			if(!options.headless)
+			{
+				initWindow();
+			}
 			initVulkan();
 			mainLoop();
 			cleanup();
+
+			//reported after cleanup so a regression still shuts down cleanly
+			if(benchmarkRegressed)
+			{
+				throw std::runtime_error("benchmark regressed against " + options.benchBaselinePath + "!");
+			}
 		}
 	
 	private:
-		GLFWwindow* window;
+		ApplicationOptions options;
+
+		GLFWwindow* window = nullptr;
 		
 		VkInstance instance;
 		VkDebugUtilsMessengerEXT debugMessenger;
@@ -199,6 +396,7 @@ class HelloTringleApplication
 		
 		VkQueue graphicsQueue;
 		VkQueue presentQueue;
+		VkQueue transferQueue;
 		
 		VkSwapchainKHR swapChain;
 		std::vector<VkImage> swapChainImages;
@@ -206,40 +404,161 @@ class HelloTringleApplication
 		VkExtent2D swapChainExtent;
 		std::vector<VkImageView> swapChainImageViews;
 		std::vector<VkFramebuffer> swapchainFramebuffers;
+		std::vector<RetiredSwapChain> retiredSwapChains;
+
+		//headless only, the offscreen images stand in for the swapchain images
+		std::vector<Allocation> offscreenImageAllocations;
+		std::vector<VkBuffer> readbackBuffers;
+		std::vector<Allocation> readbackAllocations;
+		std::vector<int64_t> readbackFrames; //frame number each frame in flight's readback buffer holds, -1 if none
+
+		VkPipelineCache pipelineCache;
+		bool pipelineCacheWarm = false;
+		bool pipelineCreationFeedbackSupported = false;
+		uint32_t pipelineCacheHits = 0;
+		uint32_t pipelineCacheMisses = 0;
+		double pipelineCacheHitTime = 0.0;
+		double pipelineCacheMissTime = 0.0;
 
 		VkRenderPass renderPass;
+		//one depth buffer shared by every framebuffer, the render pass dependencies order its use across frames in flight
+		VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+		VkImage depthImage = VK_NULL_HANDLE;
+		Allocation depthImageAllocation;
+		VkImageView depthImageView = VK_NULL_HANDLE;
+		//with msaa the scene renders into this multisampled image, resolved into the swapchain image at the end of the subpass
+		VkSampleCountFlagBits msaaSamples = VK_SAMPLE_COUNT_1_BIT;
+		VkImage colorImage = VK_NULL_HANDLE;
+		Allocation colorImageAllocation;
+		VkImageView colorImageView = VK_NULL_HANDLE;
+		//with --depth-prepass subpass 0 runs this vertex only pipeline and graphicsPipeline shades in subpass 1
+		VkPipeline depthPrepassPipeline = VK_NULL_HANDLE;
+		//--pipeline-stats, one query per scene draw secondary in every frame slot's pool
+		bool pipelineStatisticsSupported = false;
+		static const uint32_t NO_QUERY = UINT32_MAX;
+		std::vector<VkQueryPool> statisticsQueryPools;
+		std::vector<uint32_t> statisticsQueryCounts;
+		//queries the slot's last submitted frame wrote, cleared once read so a frame that is not submitted is not counted twice
+		std::vector<uint32_t> statisticsSubmittedCounts;
+		uint64_t fragmentInvocationsTotal = 0;
+		uint64_t pixelsTotal = 0;
+		uint64_t statisticsFrameCount = 0;
 		VkDescriptorSetLayout descriptorSetLayout;
 		VkPipelineLayout pipelineLayout;
 		VkPipeline graphicsPipeline;
 
+		MemoryAllocator allocator;
+		UploadEngine uploader;
+		FrameProfiler profiler;
+		Benchmark benchmark;
+		bool benchmarkRegressed = false;
+
 		VkBuffer vertexBuffer;
-		VkDeviceMemory vertexBufferMemory;
+		Allocation vertexBufferAllocation;
 		VkBuffer indexBuffer;
-		VkDeviceMemory indexBufferMemeory;
-
-		std::vector<VkBuffer> uniformBuffers;
-		std::vector<VkDeviceMemory> uniformBufferMemory;
-
-		VkDescriptorPool descriptorPool;
+		Allocation indexBufferAllocation;
+
+		//only mapped while its vertices and indices are streamed into the staging ring
+		MappedMesh meshFile;
+		//the float vertices of the mesh file or the built in quad, packed into vertexLayout's streams on upload
+		VertexSource meshVertexSource = {};
+		VertexLayout vertexLayout;
+		//where each of vertexLayout's streams starts in vertexBuffer
+		std::vector<VkDeviceSize> vertexStreamOffsets;
+		std::vector<MeshSubmesh> meshSubmeshes;
+		VkIndexType meshIndexType = VK_INDEX_TYPE_UINT16;
+		//centres the mesh on the origin and scales its largest side to 1
+		glm::vec3 meshCenter = glm::vec3(0.0f);
+		float meshScale = 1.0f;
+		//bounding sphere radius around meshCenter before scaling
+		float meshRadius = 0.0f;
+		glm::mat4 meshTransform = glm::mat4(1.0f);
+		//meshTransform after undoing the vertex layout's position quantization
+		DrawPushConstants meshDrawConstants = {};
+
+		std::vector<UniformRing> uniformRings;
+		uint32_t cameraUniformOffset = 0;
+		//written through the persistent mapping, one buffer per frame in flight
+		std::vector<VkBuffer> instanceBuffers;
+		std::vector<Allocation> instanceAllocations;
+		//sceneVersion each frame's instance buffer was last written for
+		std::vector<uint64_t> instanceVersions;
+
+		//gpu culling, only created with --gpu-culling
+		//the compute pass writes the surviving instance indices and the instance counts of one indirect draw per submesh
+		bool multiDrawIndirectSupported = false;
+		VkDescriptorSetLayout cullDescriptorSetLayout = VK_NULL_HANDLE;
+		VkPipelineLayout cullPipelineLayout = VK_NULL_HANDLE;
+		VkPipeline cullPipeline = VK_NULL_HANDLE;
+		std::vector<VkDescriptorSet> cullDescriptorSets;
+		std::vector<VkBuffer> visibleInstanceBuffers;
+		std::vector<Allocation> visibleInstanceAllocations;
+		std::vector<VkBuffer> drawCommandBuffers;
+		std::vector<Allocation> drawCommandAllocations;
+		//the draw commands with zero instances, copied over each frame's commands before culling
+		VkBuffer drawTemplateBuffer = VK_NULL_HANDLE;
+		Allocation drawTemplateAllocation;
+		uint32_t cullUniformOffset = 0;
+
+		std::vector<SceneObject> sceneObjects;
+		float cameraDistance = 1.0f;
+
+		//every set layout comes from the cache, long lived sets from descriptorAllocator
+		DescriptorLayoutCache descriptorLayoutCache;
+		DescriptorAllocator descriptorAllocator;
 		std::vector<VkDescriptorSet> descriptorSets;
 
-		VkCommandPool commandPool;
-		
+		std::vector<VkCommandPool> commandPools; //one per frame in flight, reset as a whole
 		std::vector<VkCommandBuffer> commandBuffers;
 
+		ThreadPool workers;
+		std::vector<std::vector<RecordingPool>> recordingPools; //[frame in flight][worker]
+		std::vector<RecordedDraws> recordedDraws;
+		//bumped whenever the draw list changes
+		uint64_t sceneVersion = 0;
+		double recordTimeTotal = 0.0;
+		uint64_t recordedFrameCount = 0;
+		uint64_t reusedFrameCount = 0;
+
 		std::vector<VkSemaphore> imageAvailableSemaphores;
 		std::vector<VkSemaphore> renderFinishedSemaphores;
-		std::vector<VkFence> inFlightFences;
-		std::vector<VkFence> imagesInFlight;
+		//frame n uses slot n % frameSlotCount and may start once the scheduler reports frame n - framesInFlight complete
+		//there are enough slots for the deepest present profile so switching profiles never reallocates per frame resources
+		uint32_t frameSlotCount = 2;
+		FrameScheduler frameScheduler;
+		//last frame that rendered into each swapchain or offscreen image, NO_FRAME before the first
+		static const uint64_t NO_FRAME = UINT64_MAX;
+		std::vector<uint64_t> imageFrames;
 		size_t currentFrame = 0;
+		uint64_t frameNumber = 0;
 
 		bool framebufferResized = false;
 
-		VkImage textureImage;
-		VkDeviceMemory textureImageMemory;
-		VkImageView textureImageView;
+		//the active present profile, key presses request another one which drawFrame switches to before acquiring
+		PresentProfile presentProfile = PRESENT_PROFILE_DEFAULT;
+		PresentProfile requestedPresentProfile = PRESENT_PROFILE_DEFAULT;
+		FrameLimiter frameLimiter;
+		LatencyTracker latencyTracker;
+		std::chrono::steady_clock::time_point inputSampleTime;
+
+		//decoded on the worker pool, indexed by the id the decoder hands out, the placeholder is sampled until they are resident
+		TextureDecoder textureDecoder;
+		std::vector<LoadedTexture> textures;
+		VkImage placeholderImage;
+		Allocation placeholderImageAllocation;
+		VkImageView placeholderImageView;
+		//the view each frame's descriptor set currently samples
+		std::vector<VkImageView> boundTextureViews;
 		VkSampler textureSampler;
 
+		//bindless texture table, one update after bind set shared by every frame
+		//a slot is written once when its texture becomes resident, which is before any instance refers to it
+		bool bindlessSupported = false;
+		uint32_t textureTableSize = 0;
+		VkDescriptorSetLayout textureTableLayout = VK_NULL_HANDLE;
+		DescriptorAllocator textureTableAllocator;
+		VkDescriptorSet textureTableSet = VK_NULL_HANDLE;
+
 		void initWindow()
 		{
 			glfwInit();
@@ -250,6 +569,7 @@ class HelloTringleApplication
 			window = glfwCreateWindow(WIDTH, HEIGHT, "Vulkan", nullptr, nullptr);
 			glfwSetWindowUserPointer(window, this);
 			glfwSetFramebufferSizeCallback(window, framebufferResizeCallback);
+			glfwSetKeyCallback(window, keyCallback);
 
 			if(debug_log) std::cout << "> Initialised window\n";
 		}
@@ -261,73 +581,315 @@ class HelloTringleApplication
 			app->framebufferResized = true;
 		}
 
+		//keys 1 to 4 pick a present profile in the order of PresentProfile
+		static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
+		{
+			if(action != GLFW_PRESS || key < GLFW_KEY_1 || key >= GLFW_KEY_1 + PRESENT_PROFILE_COUNT)
+			{
+				return;
+			}
+			auto app = reinterpret_cast<HelloTringleApplication*>(glfwGetWindowUserPointer(window));
+			app->requestedPresentProfile = static_cast<PresentProfile>(key - GLFW_KEY_1);
+		}
+
 		void initVulkan()
 		{
+			benchmark.beginStartup();
+			presentProfile = options.presentProfile;
+			requestedPresentProfile = presentProfile;
+			frameSlotCount = getProfileFramesInFlight(presentProfile);
+			if(!options.headless)
+			{
+				for(uint32_t i = 0; i < PRESENT_PROFILE_COUNT; i++)
+				{
+					frameSlotCount = std::max(frameSlotCount, getProfileFramesInFlight(static_cast<PresentProfile>(i)));
+				}
+			}
 			createInstance();
 			setupDebugMessenger();
-			createSurface();
+			if(!options.headless)
+			{
+				createSurface();
+			}
+			benchmark.markStartup("instance");
 			pickPysicalDevice();
 			createLogicalDevice();
-			createSwapChain();
+			createAllocator();
+			createProfiler();
+			benchmark.markStartup("device");
+			createPipelineCache();
+			if(options.headless)
+			{
+				createOffscreenTargets();
+				createReadbackBuffers();
+			}
+			else
+			{
+				createSwapChain();
+			}
 			createImageViews();
+			createColorResources();
+			createDepthResources();
 			createRenderPass();
+			benchmark.markStartup("swapchain");
 			createDescriptorSetLayout();
+			chooseVertexLayout();
 			createGraphicsPipeline();
+			createCullPipeline();
+			benchmark.markStartup("pipeline");
 			createFramebuffers();
+			benchmark.markStartup("swapchain");
 			createCommandPool();
-			createTextureImage();
-			createTextureImageView();
+			createRecordingPools();
+			createStatisticsQueryPools();
+			createUploadEngine();
+			benchmark.markStartup("commands");
+			createPlaceholderTexture();
+			startTextureLoads();
 			createTextureSampler();
+			benchmark.markStartup("texture");
+			loadMesh();
 			createVertexBuffer();
+			createScene();
+			createInstanceBuffers();
+			createCullingBuffers();
 			createUniformBuffers();
-			createDescriptorPool();
+			createDescriptorAllocators();
 			createDescriptorSets();
 			createIndexBuffer();
+			benchmark.markStartup("buffers");
 			createCommandBuffers();
 			createSyncObjects();
+			benchmark.markStartup("commands");
+
+			//the first frame is submitted to the graphics queue after the uploads so it needs no cpu wait
+			//a benchmark waits for them and the texture decodes instead so both are part of the startup numbers
+			if(!options.benchOutPath.empty())
+			{
+				textureDecoder.waitAll();
+				pollTextureLoads();
+			}
+			UploadTicket uploads = uploader.flush();
+			if(!options.benchOutPath.empty())
+			{
+				uploader.wait(uploads);
+				benchmark.markStartup("uploads");
+			}
 			if(debug_log) std::cout << "> Initialised vulkan\n";
 		}
 
 		void mainLoop()
 		{
 			if(debug_log) std::cout << "> Entering mainloop\n";
-			while(!glfwWindowShouldClose(window))
+			bool benchmarking = !options.benchOutPath.empty();
+			if(benchmarking)
+			{
+				benchmark.beginFrames(options.frameCount, options.benchWarmupFrames);
+			}
+
+			auto startTime = std::chrono::high_resolution_clock::now();
+			frameLimiter.setLimit(getPresentProfileSettings(presentProfile).frameLimit);
+			while(options.frameCount == 0 || frameNumber < options.frameCount)
 			{
-				glfwPollEvents();
+				//the limiter sleeps before the input is sampled so the wait does not add to the latency
+				frameLimiter.wait();
+				if(!options.headless)
+				{
+					if(glfwWindowShouldClose(window))
+					{
+						break;
+					}
+					glfwPollEvents();
+				}
+				inputSampleTime = std::chrono::steady_clock::now();
 				drawFrame();
+				if(benchmarking)
+				{
+					benchmark.markFrame();
+				}
+				if(options.durationSeconds > 0.0 && std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count() >= options.durationSeconds)
+				{
+					break;
+				}
 			}
 
 			vkDeviceWaitIdle(device);
+			double elapsed = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+			if(benchmarking)
+			{
+				benchmark.endFrames();
+				writeBenchmarkResults();
+			}
+			if(options.headless)
+			{
+				writePendingReadbacks();
+			}
+			if(stats_log) std::cout << "rendered " << frameNumber << " frames in " << elapsed << " s (" << frameNumber / elapsed << " fps)\n";
 			if(debug_log) std::cout << "> Exiting mainloop\n";
 		}
 
+		void writeBenchmarkResults()
+		{
+			benchmark.writeResults(options.benchOutPath, options.headless ? "headless" : "windowed");
+			if(stats_log)
+			{
+				benchmark.printSummary(std::cout);
+			}
+
+			if(!options.benchBaselinePath.empty())
+			{
+				uint32_t regressions = benchmark.compareToBaseline(options.benchBaselinePath, options.benchThreshold, std::cout);
+				if(regressions > 0)
+				{
+					std::cout << regressions << " metrics regressed by more than " << options.benchThreshold * 100.0 << "%\n";
+					benchmarkRegressed = true;
+				}
+			}
+		}
+
 		void cleanup()
 		{
 			if(debug_log) std::cout << "> Starting cleanup\n";
 			
 			cleanupSwapChain();
+			destroyRetiredSwapChains(true);
+
+			vkDestroyPipeline(device, graphicsPipeline, nullptr);
+			if(depthPrepassPipeline != VK_NULL_HANDLE)
+			{
+				vkDestroyPipeline(device, depthPrepassPipeline, nullptr);
+			}
+			vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+			vkDestroyRenderPass(device, renderPass, nullptr);
+
+			for(VkQueryPool queryPool : statisticsQueryPools)
+			{
+				vkDestroyQueryPool(device, queryPool, nullptr);
+			}
+
+			for(size_t i = 0; i < readbackBuffers.size(); i++)
+			{
+				vkDestroyBuffer(device, readbackBuffers[i], nullptr);
+				allocator.free(readbackAllocations[i]);
+			}
+
+			for(size_t i = 0; i < instanceBuffers.size(); i++)
+			{
+				vkDestroyBuffer(device, instanceBuffers[i], nullptr);
+				allocator.free(instanceAllocations[i]);
+			}
+
+			for(size_t i = 0; i < visibleInstanceBuffers.size(); i++)
+			{
+				vkDestroyBuffer(device, visibleInstanceBuffers[i], nullptr);
+				allocator.free(visibleInstanceAllocations[i]);
+				vkDestroyBuffer(device, drawCommandBuffers[i], nullptr);
+				allocator.free(drawCommandAllocations[i]);
+			}
+			if(drawTemplateBuffer != VK_NULL_HANDLE)
+			{
+				vkDestroyBuffer(device, drawTemplateBuffer, nullptr);
+				allocator.free(drawTemplateAllocation);
+			}
+			if(cullPipeline != VK_NULL_HANDLE)
+			{
+				vkDestroyPipeline(device, cullPipeline, nullptr);
+				vkDestroyPipelineLayout(device, cullPipelineLayout, nullptr);
+			}
+
+			for(auto& ring : uniformRings)
+			{
+				vkDestroyBuffer(device, ring.buffer, nullptr);
+				allocator.free(ring.allocation);
+			}
+
+			descriptorAllocator.destroy();
+			textureTableAllocator.destroy();
 
 			vkDestroySampler(device, textureSampler, nullptr);
-			vkDestroyImageView(device, textureImageView, nullptr);
-			vkDestroyImage(device, textureImage, nullptr);
-			vkFreeMemory(device, textureImageMemory, nullptr);
+			for(LoadedTexture& texture : textures)
+			{
+				if(texture.image != VK_NULL_HANDLE)
+				{
+					vkDestroyImageView(device, texture.view, nullptr);
+					vkDestroyImage(device, texture.image, nullptr);
+					allocator.free(texture.allocation);
+				}
+			}
+			vkDestroyImageView(device, placeholderImageView, nullptr);
+			vkDestroyImage(device, placeholderImage, nullptr);
+			allocator.free(placeholderImageAllocation);
 
-			vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+			descriptorLayoutCache.destroy();
 
 			vkDestroyBuffer(device, indexBuffer, nullptr);
-			vkFreeMemory(device, indexBufferMemeory, nullptr);
+			allocator.free(indexBufferAllocation);
 
 			vkDestroyBuffer(device, vertexBuffer, nullptr);
-			vkFreeMemory(device, vertexBufferMemory, nullptr);
+			allocator.free(vertexBufferAllocation);
 
-			for(size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+			for(size_t i = 0; i < frameSlotCount; i++)
 			{
 				vkDestroySemaphore(device, renderFinishedSemaphores[i], nullptr);
 				vkDestroySemaphore(device, imageAvailableSemaphores[i], nullptr);
-				vkDestroyFence(device, inFlightFences[i], nullptr);
 			}
+			frameScheduler.destroy();
+
+			for(auto pool : commandPools)
+			{
+				vkDestroyCommandPool(device, pool, nullptr);
+			}
+
+			for(auto& framePools : recordingPools)
+			{
+				for(auto& recordingPool : framePools)
+				{
+					vkDestroyCommandPool(device, recordingPool.pool, nullptr);
+				}
+			}
+			workers.destroy();
+
+			uploader.destroy();
+
+			if(!options.profileOutPath.empty())
+			{
+				profiler.exportHistory(options.profileOutPath, options.profileFormat);
+			}
+			profiler.destroy();
 
-			vkDestroyCommandPool(device, commandPool, nullptr);
+			if(stats_log)
+			{
+				allocator.printStats(std::cout);
+				uploader.printStats(std::cout);
+				frameScheduler.printStats(std::cout);
+				latencyTracker.printStats(std::cout);
+				if(statisticsFrameCount > 0)
+				{
+					std::cout << "fragment shader invocations: " << fragmentInvocationsTotal / statisticsFrameCount << " per frame, " << static_cast<double>(fragmentInvocationsTotal) / pixelsTotal << " per pixel over " << statisticsFrameCount << " frames" << (options.depthPrepass ? " with depth pre-pass" : "") << "\n";
+				}
+				descriptorLayoutCache.printStats(std::cout);
+				descriptorAllocator.printStats(std::cout, "(persistent sets)");
+				if(bindlessSupported)
+				{
+					textureTableAllocator.printStats(std::cout, "(texture table)");
+				}
+				for(size_t i = 0; i < uniformRings.size(); i++)
+				{
+					std::cout << "uniform ring " << i << ": peak " << uniformRings[i].peak << " of " << uniformRings[i].capacity << " bytes\n";
+				}
+				std::cout << "pipeline cache (" << (pipelineCacheWarm ? "loaded from disk" : "cold") << "):\n";
+				std::cout << "\t  hits: " << pipelineCacheHits << " in " << pipelineCacheHitTime << " ms\n";
+				std::cout << "\t  misses: " << pipelineCacheMisses << " in " << pipelineCacheMissTime << " ms\n";
+				profiler.printSummary(std::cout);
+				if(recordedFrameCount > 0)
+				{
+					std::cout << "command recording (" << workers.getWorkerSlotCount() << " threads): " << recordTimeTotal / recordedFrameCount << " ms per frame over " << recordedFrameCount << " frames, " << reusedFrameCount << " reused their scene draws\n";
+				}
+			}
+			allocator.destroy();
+
+			savePipelineCache();
+			vkDestroyPipelineCache(device, pipelineCache, nullptr);
 			
 			vkDestroyDevice(device, nullptr);
 			
@@ -336,12 +898,17 @@ class HelloTringleApplication
 				DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
 			}
 			
-			vkDestroySurfaceKHR(instance, surface, nullptr);
+			if(!options.headless)
+			{
+				vkDestroySurfaceKHR(instance, surface, nullptr);
+			}
 			vkDestroyInstance(instance, nullptr);
 
-			glfwDestroyWindow(window);
-
-			glfwTerminate();
+			if(!options.headless)
+			{
+				glfwDestroyWindow(window);
+				glfwTerminate();
+			}
 			if(debug_log) std::cout << "> Ending cleanup\n";
 		}
 
@@ -352,43 +919,125 @@ class HelloTringleApplication
 				vkDestroyFramebuffer(device, framebuffer, nullptr);
 			}
 
-			vkFreeCommandBuffers(device, commandPool, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
-			
-			vkDestroyPipeline(device, graphicsPipeline, nullptr);
-			vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
-			vkDestroyRenderPass(device, renderPass, nullptr);
+			vkDestroyImageView(device, depthImageView, nullptr);
+			vkDestroyImage(device, depthImage, nullptr);
+			allocator.free(depthImageAllocation);
+
+			if(colorImage != VK_NULL_HANDLE)
+			{
+				vkDestroyImageView(device, colorImageView, nullptr);
+				vkDestroyImage(device, colorImage, nullptr);
+				allocator.free(colorImageAllocation);
+			}
 			
 			for (auto imageView : swapChainImageViews)
 			{
 				vkDestroyImageView(device, imageView, nullptr);
 			}
 
+			if(options.headless)
+			{
+				for(size_t i = 0; i < swapChainImages.size(); i++)
+				{
+					vkDestroyImage(device, swapChainImages[i], nullptr);
+					allocator.free(offscreenImageAllocations[i]);
+				}
+				return;
+			}
+
 			vkDestroySwapchainKHR(device, swapChain, nullptr);
+		}
 
-			for(size_t i = 0; i < swapChainImages.size(); i++)
+		//only the extent dependent objects are rebuilt, viewport and scissor are dynamic pipeline state
+		//the old swapchain is handed to the new one and destroyed later instead of idling the device
+		//firstNewFrame is the first frame that renders to the new swapchain, frameNumber + 1 once frameNumber has been submitted
+		void recreateSwapChain(uint64_t firstNewFrame)
+		{
+			int width = 0, height = 0;
+			glfwGetFramebufferSize(window, &width, &height);
+			while(width == 0 || height == 0)
 			{
-				vkDestroyBuffer(device, uniformBuffers[i], nullptr);
-				vkFreeMemory(device, uniformBufferMemory[i], nullptr);
+				//minimised, nothing to present to
+				glfwGetFramebufferSize(window, &width, &height);
+				glfwWaitEvents();
+			}
+
+			RetiredSwapChain retired = {};
+			retired.swapChain = swapChain;
+			retired.imageViews = std::move(swapChainImageViews);
+			retired.framebuffers = std::move(swapchainFramebuffers);
+			retired.depthImage = depthImage;
+			retired.depthImageAllocation = depthImageAllocation;
+			retired.depthImageView = depthImageView;
+			retired.colorImage = colorImage;
+			retired.colorImageAllocation = colorImageAllocation;
+			retired.colorImageView = colorImageView;
+			retired.retiredFrame = firstNewFrame;
+			retiredSwapChains.push_back(std::move(retired));
+
+			VkFormat oldFormat = swapChainImageFormat;
+
+			createSwapChain(retiredSwapChains.back().swapChain);
+			createImageViews();
+			createColorResources();
+			createDepthResources();
+
+			//the render pass only depends on the format, which practically never changes on a resize
+			if(swapChainImageFormat != oldFormat)
+			{
+				vkDeviceWaitIdle(device);
+				vkDestroyPipeline(device, graphicsPipeline, nullptr);
+				if(depthPrepassPipeline != VK_NULL_HANDLE)
+				{
+					vkDestroyPipeline(device, depthPrepassPipeline, nullptr);
+				}
+				vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+				vkDestroyRenderPass(device, renderPass, nullptr);
+				createRenderPass();
+				createGraphicsPipeline();
 			}
 
-			vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+			createFramebuffers();
+
+			imageFrames.assign(swapChainImages.size(), NO_FRAME);
+
+			//the recorded viewport and scissor are stale
+			invalidateRecordedDraws();
 		}
 
-		void recreateSwapChain()
+		//frames up to retiredFrame - 1 may have rendered to the old swapchain, it goes once the scheduler reports the last of them complete
+		void destroyRetiredSwapChains(bool all)
 		{
-			vkDeviceWaitIdle(device);
+			auto it = retiredSwapChains.begin();
+			while(it != retiredSwapChains.end())
+			{
+				if(!all && it->retiredFrame > 0 && !frameScheduler.isFrameComplete(it->retiredFrame - 1))
+				{
+					it++;
+					continue;
+				}
 
-			cleanupSwapChain();
+				for(auto framebuffer : it->framebuffers)
+				{
+					vkDestroyFramebuffer(device, framebuffer, nullptr);
+				}
+				for(auto imageView : it->imageViews)
+				{
+					vkDestroyImageView(device, imageView, nullptr);
+				}
+				vkDestroyImageView(device, it->depthImageView, nullptr);
+				vkDestroyImage(device, it->depthImage, nullptr);
+				allocator.free(it->depthImageAllocation);
+				if(it->colorImage != VK_NULL_HANDLE)
+				{
+					vkDestroyImageView(device, it->colorImageView, nullptr);
+					vkDestroyImage(device, it->colorImage, nullptr);
+					allocator.free(it->colorImageAllocation);
+				}
+				vkDestroySwapchainKHR(device, it->swapChain, nullptr);
 
-			createSwapChain();
-			createImageViews();
-			createRenderPass();
-			createGraphicsPipeline();
-			createFramebuffers();
-			createUniformBuffers();
-			createDescriptorPool();
-			createDescriptorSets();
-			createCommandBuffers();
+				it = retiredSwapChains.erase(it);
+			}
 		}
 
 		void createInstance()
@@ -404,7 +1053,7 @@ class HelloTringleApplication
 			appInfo.applicationVersion = VK_MAKE_VERSION(1,0,0);
 			appInfo.pEngineName = "No Engine";
 			appInfo.engineVersion = VK_MAKE_VERSION(1,0,0);
-			appInfo.apiVersion = VK_API_VERSION_1_0;
+			appInfo.apiVersion = VK_API_VERSION_1_2;
 
 			VkInstanceCreateInfo createInfo = {};
 			createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -516,6 +1165,8 @@ class HelloTringleApplication
 			{
 				throw std::runtime_error("failed to find a suitable GPU!");
 			}
+
+			msaaSamples = getMaxUsableSampleCount(options.msaaSamples);
 			if(debug_log) std::cout << "> Picked physical device\n";
 		}
 
@@ -524,7 +1175,11 @@ class HelloTringleApplication
 			QueueFamilyIndicies indicies = findQueueFamilies(physicalDevice);
 
 			std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-			std::set<uint32_t> uniqueQueueFamilies = {indicies.graphicsFamily.value(), indicies.presentFamily.value()};
+			std::set<uint32_t> uniqueQueueFamilies = {indicies.graphicsFamily.value(), indicies.presentFamily.value_or(indicies.graphicsFamily.value())};
+			if(indicies.transferFamily.has_value())
+			{
+				uniqueQueueFamilies.insert(indicies.transferFamily.value());
+			}
 			
 			float queuePriority = 1.0f;
 			for(uint32_t queueFamily : uniqueQueueFamilies)
@@ -538,16 +1193,59 @@ class HelloTringleApplication
 				queueCreateInfos.push_back(queueCreateInfo);
 			}
 
+			VkPhysicalDeviceFeatures supportedFeatures;
+			vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
+			//lets gpu culling draw every submesh with one indirect call
 			VkPhysicalDeviceFeatures deviceFeatures = {};
+			deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+			multiDrawIndirectSupported = supportedFeatures.multiDrawIndirect == VK_TRUE;
+			pipelineStatisticsSupported = options.pipelineStatistics && supportedFeatures.pipelineStatisticsQuery == VK_TRUE;
+			deviceFeatures.pipelineStatisticsQuery = pipelineStatisticsSupported;
+			//compressed formats only report support when their feature is enabled
+			deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+			deviceFeatures.textureCompressionETC2 = supportedFeatures.textureCompressionETC2;
+			deviceFeatures.textureCompressionASTC_LDR = supportedFeatures.textureCompressionASTC_LDR;
+
+			//descriptor indexing is core in vulkan 1.2, the bindless texture table needs the update after bind and partially bound parts of it
+			VkPhysicalDeviceVulkan12Features supportedFeatures12 = getVulkan12Features(physicalDevice);
+			bindlessSupported = options.bindless
+				&& supportedFeatures12.runtimeDescriptorArray
+				&& supportedFeatures12.descriptorBindingPartiallyBound
+				&& supportedFeatures12.descriptorBindingSampledImageUpdateAfterBind
+				&& supportedFeatures12.descriptorBindingUpdateUnusedWhilePending
+				&& supportedFeatures12.shaderSampledImageArrayNonUniformIndexing;
+
+			VkPhysicalDeviceVulkan12Features enabledFeatures12 = {};
+			enabledFeatures12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+			enabledFeatures12.runtimeDescriptorArray = bindlessSupported;
+			enabledFeatures12.descriptorBindingPartiallyBound = bindlessSupported;
+			enabledFeatures12.descriptorBindingSampledImageUpdateAfterBind = bindlessSupported;
+			enabledFeatures12.descriptorBindingUpdateUnusedWhilePending = bindlessSupported;
+			enabledFeatures12.shaderSampledImageArrayNonUniformIndexing = bindlessSupported;
+			//isDeviceSuitable only accepts devices with timeline semaphores
+			enabledFeatures12.timelineSemaphore = VK_TRUE;
+
 			VkDeviceCreateInfo createInfo = {};
 			createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+			createInfo.pNext = &enabledFeatures12;
 			createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 			createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
 			createInfo.pEnabledFeatures = &deviceFeatures;
 
-			createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-			createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+			std::vector<const char*> enabledExtensions = getRequiredDeviceExtensions();
+			for(const char* extension : optionalDeviceExtensions)
+			{
+				if(isDeviceExtensionSupported(physicalDevice, extension))
+				{
+					enabledExtensions.push_back(extension);
+				}
+			}
+			pipelineCreationFeedbackSupported = isDeviceExtensionSupported(physicalDevice, VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME);
+
+			createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+			createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
 			if(enableValidationLayers)
 			{
@@ -565,28 +1263,195 @@ class HelloTringleApplication
 			}
 			
 			vkGetDeviceQueue(device, indicies.graphicsFamily.value(), 0, &graphicsQueue);
-			vkGetDeviceQueue(device, indicies.presentFamily.value(), 0, &presentQueue);
+			vkGetDeviceQueue(device, indicies.presentFamily.value_or(indicies.graphicsFamily.value()), 0, &presentQueue);
+			if(indicies.transferFamily.has_value())
+			{
+				vkGetDeviceQueue(device, indicies.transferFamily.value(), 0, &transferQueue);
+			}
+			else
+			{
+				transferQueue = graphicsQueue;
+			}
 			if(debug_log) std::cout << "> Created logical device\n";
 		}
 
-		void createSwapChain()
+		//loads the pipeline cache written by the previous run, a cache from another device or driver is discarded
+		void createPipelineCache()
 		{
-			SwapChainSupportDetails swapChainSupport = querySwapChainSupport(physicalDevice);
+			VkPhysicalDeviceProperties deviceProperties;
+			vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
 
-			VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
-			VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
-			VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
+			std::vector<char> cacheData;
+			std::ifstream file(PIPELINE_CACHE_FILE, std::ios::ate | std::ios::binary);
+			if(file.is_open())
+			{
+				cacheData.resize((size_t) file.tellg());
+				file.seekg(0);
+				file.read(cacheData.data(), cacheData.size());
+				file.close();
+			}
+
+			pipelineCacheWarm = false;
+			if(cacheData.size() >= sizeof(VkPipelineCacheHeaderVersionOne))
+			{
+				VkPipelineCacheHeaderVersionOne header;
+				memcpy(&header, cacheData.data(), sizeof(header));
 
-			uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
+				pipelineCacheWarm =
+					header.headerSize >= sizeof(VkPipelineCacheHeaderVersionOne) &&
+					header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+					header.vendorID == deviceProperties.vendorID &&
+					header.deviceID == deviceProperties.deviceID &&
+					memcmp(header.pipelineCacheUUID, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
 
-			if(swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount)
+				if(!pipelineCacheWarm && debug_log) std::cout << ">> discarding pipeline cache from a different device or driver\n";
+			}
+
+			VkPipelineCacheCreateInfo cacheInfo = {};
+			cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+			cacheInfo.initialDataSize = pipelineCacheWarm ? cacheData.size() : 0;
+			cacheInfo.pInitialData = pipelineCacheWarm ? cacheData.data() : nullptr;
+
+			if(vkCreatePipelineCache(device, &cacheInfo, nullptr, &pipelineCache) != VK_SUCCESS)
 			{
-				imageCount = swapChainSupport.capabilities.maxImageCount;
+				throw std::runtime_error("failed to create pipeline cache!");
 			}
+			if(debug_log) std::cout << "> Created pipeline cache\n";
+		}
 
-			VkSwapchainCreateInfoKHR createInfo = {};
-			createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
-			createInfo.surface = surface;
+		void savePipelineCache()
+		{
+			size_t dataSize = 0;
+			if(vkGetPipelineCacheData(device, pipelineCache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0)
+			{
+				return;
+			}
+
+			std::vector<char> cacheData(dataSize);
+			if(vkGetPipelineCacheData(device, pipelineCache, &dataSize, cacheData.data()) != VK_SUCCESS)
+			{
+				std::cerr << "failed to read back pipeline cache\n";
+				return;
+			}
+
+			std::ofstream file(PIPELINE_CACHE_FILE, std::ios::binary | std::ios::trunc);
+			if(!file.is_open())
+			{
+				std::cerr << "failed to write pipeline cache to " << PIPELINE_CACHE_FILE << "\n";
+				return;
+			}
+			file.write(cacheData.data(), dataSize);
+			if(debug_log) std::cout << "> Saved pipeline cache (" << dataSize << " bytes)\n";
+		}
+
+		//creates a graphics pipeline through the shared cache and records whether the cache served it
+		VkPipeline createCachedGraphicsPipeline(VkGraphicsPipelineCreateInfo& pipelineInfo)
+		{
+			VkPipelineCreationFeedbackEXT pipelineFeedback = {};
+			std::vector<VkPipelineCreationFeedbackEXT> stageFeedbacks(pipelineInfo.stageCount);
+
+			VkPipelineCreationFeedbackCreateInfoEXT feedbackInfo = {};
+			feedbackInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO_EXT;
+			feedbackInfo.pPipelineCreationFeedback = &pipelineFeedback;
+			feedbackInfo.pipelineStageCreationFeedbackCount = pipelineInfo.stageCount;
+			feedbackInfo.pPipelineStageCreationFeedbacks = stageFeedbacks.data();
+
+			if(pipelineCreationFeedbackSupported)
+			{
+				feedbackInfo.pNext = pipelineInfo.pNext;
+				pipelineInfo.pNext = &feedbackInfo;
+			}
+
+			auto startTime = std::chrono::high_resolution_clock::now();
+
+			VkPipeline pipeline;
+			if(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to creategraphics pipeline!");
+			}
+
+			double elapsed = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+			if(pipelineCreationFeedbackSupported)
+			{
+				pipelineInfo.pNext = feedbackInfo.pNext;
+			}
+
+			//without the feedback extension the best guess is whether a valid cache was loaded
+			bool hit = pipelineCacheWarm;
+			if(pipelineCreationFeedbackSupported && (pipelineFeedback.flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT_EXT))
+			{
+				hit = (pipelineFeedback.flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT_EXT) != 0;
+			}
+
+			if(hit)
+			{
+				pipelineCacheHits++;
+				pipelineCacheHitTime += elapsed;
+			}
+			else
+			{
+				pipelineCacheMisses++;
+				pipelineCacheMissTime += elapsed;
+			}
+			if(debug_log) std::cout << ">> pipeline created in " << elapsed << " ms (cache " << (hit ? "hit" : "miss") << ")\n";
+
+			return pipeline;
+		}
+
+		void createAllocator()
+		{
+			allocator.init(physicalDevice, device);
+			if(debug_log) std::cout << "> Created memory allocator\n";
+		}
+
+		void createProfiler()
+		{
+			VkPhysicalDeviceProperties deviceProperties;
+			vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+			uint32_t queueFamilyCount = 0;
+			vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+			std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+			vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+			uint32_t graphicsFamily = findQueueFamilies(physicalDevice).graphicsFamily.value();
+			profiler.init(device, deviceProperties.limits.timestampPeriod, queueFamilies[graphicsFamily].timestampValidBits, frameSlotCount);
+			if(debug_log) std::cout << "> Created profiler" << (profiler.hasGpuTimestamps() ? "" : " (no gpu timestamps)") << "\n";
+		}
+
+		void createUploadEngine()
+		{
+			QueueFamilyIndicies queueFamilyIndicies = findQueueFamilies(physicalDevice);
+			uint32_t graphicsFamily = queueFamilyIndicies.graphicsFamily.value();
+			uint32_t transferFamily = queueFamilyIndicies.transferFamily.value_or(graphicsFamily);
+
+			uploader.init(device, &allocator, graphicsFamily, graphicsQueue, transferFamily, transferQueue, STAGING_RING_SIZE);
+			if(profiler.hasGpuTimestamps())
+			{
+				uploader.enableTimestamps([this](uint64_t beginTicks, uint64_t endTicks) { profiler.addGpuZoneTicks("uploads", beginTicks, endTicks); });
+			}
+			if(debug_log) std::cout << "> Created upload engine" << (uploader.hasDedicatedTransferQueue() ? " (dedicated transfer queue)" : "") << "\n";
+		}
+
+		void createSwapChain(VkSwapchainKHR oldSwapChain = VK_NULL_HANDLE)
+		{
+			SwapChainSupportDetails swapChainSupport = querySwapChainSupport(physicalDevice);
+
+			VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
+			VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
+			VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
+
+			uint32_t imageCount = swapChainSupport.capabilities.minImageCount + getPresentProfileSettings(presentProfile).extraImages;
+
+			if(swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount)
+			{
+				imageCount = swapChainSupport.capabilities.maxImageCount;
+			}
+
+			VkSwapchainCreateInfoKHR createInfo = {};
+			createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+			createInfo.surface = surface;
 			createInfo.minImageCount = imageCount;
 			createInfo.imageFormat = surfaceFormat.format;
 			createInfo.imageColorSpace = surfaceFormat.colorSpace;
@@ -613,7 +1478,7 @@ class HelloTringleApplication
 			createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
 			createInfo.presentMode = presentMode;
 			createInfo.clipped = VK_TRUE;
-			createInfo.oldSwapchain = VK_NULL_HANDLE;
+			createInfo.oldSwapchain = oldSwapChain;
 
 			if(vkCreateSwapchainKHR(device, &createInfo, nullptr, &swapChain) != VK_SUCCESS)
 			{
@@ -629,30 +1494,222 @@ class HelloTringleApplication
 			if(debug_log) std::cout << "> Created swap chain\n";
 		}
 
+		//headless replacement for createSwapChain, the images are cycled through like swapchain images
+		void createOffscreenTargets()
+		{
+			uint32_t imageCount = frameSlotCount + 1;
+
+			swapChain = VK_NULL_HANDLE;
+			swapChainImageFormat = VK_FORMAT_R8G8B8A8_UNORM;
+			swapChainExtent = {static_cast<uint32_t>(WIDTH), static_cast<uint32_t>(HEIGHT)};
+
+			swapChainImages.resize(imageCount);
+			offscreenImageAllocations.resize(imageCount);
+			for(uint32_t i = 0; i < imageCount; i++)
+			{
+				createImage(swapChainExtent.width, swapChainExtent.height, 1, VK_SAMPLE_COUNT_1_BIT, swapChainImageFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, swapChainImages[i], offscreenImageAllocations[i]);
+			}
+			if(debug_log) std::cout << "> Created " << imageCount << " offscreen targets\n";
+		}
+
+		//one host visible buffer per frame in flight, read on the cpu once the frame's fence comes around again
+		void createReadbackBuffers()
+		{
+			readbackFrames.assign(frameSlotCount, -1);
+			if(options.readbackPath.empty())
+			{
+				return;
+			}
+
+			VkDeviceSize bufferSize = static_cast<VkDeviceSize>(swapChainExtent.width) * swapChainExtent.height * 4;
+
+			readbackBuffers.resize(frameSlotCount);
+			readbackAllocations.resize(frameSlotCount);
+			for(size_t i = 0; i < frameSlotCount; i++)
+			{
+				createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, readbackBuffers[i], readbackAllocations[i]);
+			}
+			if(debug_log) std::cout << "> Created readback buffers\n";
+		}
+
+		bool isReadbackFrame()
+		{
+			return options.headless && !options.readbackPath.empty() && frameNumber % options.readbackInterval == 0;
+		}
+
+		//copies the rendered image into this frame's readback buffer, recorded after the render pass
+		void recordReadback(VkCommandBuffer commandBuffer, uint32_t imageIndex)
+		{
+			VkBufferImageCopy region = {};
+			region.bufferOffset = 0;
+			region.bufferRowLength = 0;
+			region.bufferImageHeight = 0;
+			region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			region.imageSubresource.mipLevel = 0;
+			region.imageSubresource.baseArrayLayer = 0;
+			region.imageSubresource.layerCount = 1;
+			region.imageOffset = {0, 0, 0};
+			region.imageExtent = {swapChainExtent.width, swapChainExtent.height, 1};
+
+			vkCmdCopyImageToBuffer(commandBuffer, swapChainImages[imageIndex], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readbackBuffers[currentFrame], 1, &region);
+
+			VkBufferMemoryBarrier barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.buffer = readbackBuffers[currentFrame];
+			barrier.offset = 0;
+			barrier.size = VK_WHOLE_SIZE;
+
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+			readbackFrames[currentFrame] = static_cast<int64_t>(frameNumber);
+		}
+
+		//writes the frame held in a readback buffer as a binary ppm, its fence must have been waited on
+		void writeReadback(size_t frame)
+		{
+			if(readbackFrames.empty() || readbackFrames[frame] < 0)
+			{
+				return;
+			}
+
+			std::string filename = options.readbackPath + "_" + std::to_string(readbackFrames[frame]) + ".ppm";
+			std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+			if(!file.is_open())
+			{
+				throw std::runtime_error("failed to open readback file!");
+			}
+
+			uint32_t width = swapChainExtent.width;
+			uint32_t height = swapChainExtent.height;
+			const uint8_t* pixels = static_cast<const uint8_t*>(readbackAllocations[frame].mapped);
+			bool bgra = swapChainImageFormat == VK_FORMAT_B8G8R8A8_UNORM || swapChainImageFormat == VK_FORMAT_B8G8R8A8_SRGB;
+
+			file << "P6\n" << width << " " << height << "\n255\n";
+			std::vector<char> row(width * 3);
+			for(uint32_t y = 0; y < height; y++)
+			{
+				for(uint32_t x = 0; x < width; x++)
+				{
+					const uint8_t* pixel = pixels + (static_cast<size_t>(y) * width + x) * 4;
+					row[x * 3 + 0] = pixel[bgra ? 2 : 0];
+					row[x * 3 + 1] = pixel[1];
+					row[x * 3 + 2] = pixel[bgra ? 0 : 2];
+				}
+				file.write(row.data(), row.size());
+			}
+
+			readbackFrames[frame] = -1;
+			if(debug_log) std::cout << ">> wrote " << filename << "\n";
+		}
+
+		void writePendingReadbacks()
+		{
+			for(size_t i = 0; i < readbackFrames.size(); i++)
+			{
+				writeReadback(i);
+			}
+		}
+
 		void createImageViews()
 		{
 			swapChainImageViews.resize(swapChainImages.size());
 
 			for(size_t i = 0; i < swapChainImages.size(); i++)
 			{
-				swapChainImageViews[i] = createImageView(swapChainImages[i], swapChainImageFormat);
+				swapChainImageViews[i] = createImageView(swapChainImages[i], swapChainImageFormat, 1);
 			}
 			if(debug_log) std::cout << "> Created image views\n";
 		}
 
+		VkFormat findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features)
+		{
+			for(VkFormat format : candidates)
+			{
+				VkFormatProperties properties;
+				vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+				VkFormatFeatureFlags supported = tiling == VK_IMAGE_TILING_LINEAR ? properties.linearTilingFeatures : properties.optimalTilingFeatures;
+				if((supported & features) == features)
+				{
+					return format;
+				}
+			}
+			throw std::runtime_error("failed to find supported format!");
+		}
+
+		//most precise first, formats with stencil only because some devices lack plain D32, D16 is always supported
+		VkFormat findDepthFormat()
+		{
+			return findSupportedFormat({VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_X8_D24_UNORM_PACK32, VK_FORMAT_D24_UNORM_S8_UINT, VK_FORMAT_D16_UNORM}, VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+		}
+
+		//the depth contents are never needed after the render pass, so they are cleared on load, not stored and may stay in tile memory
+		void createDepthResources()
+		{
+			if(depthFormat == VK_FORMAT_UNDEFINED)
+			{
+				depthFormat = findDepthFormat();
+			}
+			createImage(swapChainExtent.width, swapChainExtent.height, 1, msaaSamples, depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, depthImage, depthImageAllocation);
+			depthImageView = createImageView(depthImage, depthFormat, 1, VK_IMAGE_ASPECT_DEPTH_BIT);
+			if(debug_log) std::cout << "> Created depth buffer with format " << depthFormat << "\n";
+		}
+
+		//only the resolved swapchain image is kept, the samples are transient like the depth buffer
+		void createColorResources()
+		{
+			if(msaaSamples == VK_SAMPLE_COUNT_1_BIT)
+			{
+				colorImage = VK_NULL_HANDLE;
+				return;
+			}
+			createImage(swapChainExtent.width, swapChainExtent.height, 1, msaaSamples, swapChainImageFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, colorImage, colorImageAllocation);
+			colorImageView = createImageView(colorImage, swapChainImageFormat, 1);
+			if(debug_log) std::cout << "> Created " << msaaSamples << "x multisampled colour target\n";
+		}
+
+		//packed formats the device cannot fetch from a vertex buffer fall back to floats attribute by attribute
+		void chooseVertexLayout()
+		{
+			vertexLayout.init(options.vertexLayout, [this](VkFormat format)
+			{
+				VkFormatProperties properties;
+				vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+				return (properties.bufferFeatures & VK_FORMAT_FEATURE_VERTEX_BUFFER_BIT) != 0;
+			});
+			if(debug_log) std::cout << "> Chose " << getVertexLayoutName(options.vertexLayout) << " vertex layout, " << vertexLayout.getVertexSize() << " bytes per vertex in " << vertexLayout.getStreamCount() << " streams\n";
+		}
+
 		void createGraphicsPipeline()
 		{
 			auto vertShaderCode = readFile("shaders/vert.spv");
-			auto fragShaderCode = readFile("shaders/frag.spv");
+			auto fragShaderCode = readFile(bindlessSupported ? "shaders/frag_bindless.spv" : "shaders/frag.spv");
 
 			VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
 			VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
 
+			//constant_id 0 makes the vertex shader look its instance up in the culling output
+			VkBool32 gpuCullingConstant = options.gpuCulling ? VK_TRUE : VK_FALSE;
+			VkSpecializationMapEntry specializationEntry = {};
+			specializationEntry.constantID = 0;
+			specializationEntry.offset = 0;
+			specializationEntry.size = sizeof(VkBool32);
+
+			VkSpecializationInfo specializationInfo = {};
+			specializationInfo.mapEntryCount = 1;
+			specializationInfo.pMapEntries = &specializationEntry;
+			specializationInfo.dataSize = sizeof(VkBool32);
+			specializationInfo.pData = &gpuCullingConstant;
+
 			VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
 			vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 			vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
 			vertShaderStageInfo.module = vertShaderModule;
 			vertShaderStageInfo.pName = "main";
+			vertShaderStageInfo.pSpecializationInfo = &specializationInfo;
 
 			VkPipelineShaderStageCreateInfo fragShaderStageInfo = {};
 			fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -662,14 +1719,14 @@ class HelloTringleApplication
 
 			VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
 
-			auto bindingDesciption = Vertex::getBindingDescription();
-			auto attributeDesciptions = Vertex::getAttributeDescription();
+			auto bindingDesciptions = vertexLayout.getBindingDescriptions();
+			auto attributeDesciptions = vertexLayout.getAttributeDescriptions();
 
 			VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
 			vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-			vertexInputInfo.vertexBindingDescriptionCount = 1;
+			vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDesciptions.size());
 			vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDesciptions.size());
-			vertexInputInfo.pVertexBindingDescriptions = &bindingDesciption;
+			vertexInputInfo.pVertexBindingDescriptions = bindingDesciptions.data();
 			vertexInputInfo.pVertexAttributeDescriptions = attributeDesciptions.data();
 
 			VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
@@ -677,24 +1734,20 @@ class HelloTringleApplication
 			inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
 			inputAssembly.primitiveRestartEnable = VK_FALSE;
 
-			VkViewport viewport = {};
-			viewport.x = 0.0f;
-			viewport.y = 0.0f;
-			viewport.width = (float) swapChainExtent.width;
-			viewport.height = (float) swapChainExtent.height;
-			viewport.minDepth = 0.0f;
-			viewport.maxDepth = 1.0f;
-
-			VkRect2D scissor = {};
-			scissor.offset = {0, 0};
-			scissor.extent = swapChainExtent;
-
+			//viewport and scissor are set when recording so a resize does not invalidate the pipeline
 			VkPipelineViewportStateCreateInfo viewportState = {};
 			viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
 			viewportState.viewportCount = 1;
-			viewportState.pViewports = &viewport;
+			viewportState.pViewports = nullptr;
 			viewportState.scissorCount = 1;
-			viewportState.pScissors = &scissor;
+			viewportState.pScissors = nullptr;
+
+			std::array<VkDynamicState, 2> dynamicStates = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+
+			VkPipelineDynamicStateCreateInfo dynamicState = {};
+			dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+			dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+			dynamicState.pDynamicStates = dynamicStates.data();
 
 			VkPipelineRasterizationStateCreateInfo rasterizer = {};
 			rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
@@ -712,12 +1765,21 @@ class HelloTringleApplication
 			VkPipelineMultisampleStateCreateInfo multisampling = {};
 			multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
 			multisampling.sampleShadingEnable = VK_FALSE;
-			multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+			multisampling.rasterizationSamples = msaaSamples;
 			multisampling.minSampleShading = 1.0f; //optional
 			multisampling.pSampleMask = nullptr; //optional
 			multisampling.alphaToCoverageEnable = VK_FALSE; //optional
 			multisampling.alphaToOneEnable = VK_FALSE; //optional
 
+			//after a depth pre-pass the depth buffer already holds the nearest surface, only fragments matching it are shaded
+			VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+			depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+			depthStencil.depthTestEnable = VK_TRUE;
+			depthStencil.depthWriteEnable = options.depthPrepass ? VK_FALSE : VK_TRUE;
+			depthStencil.depthCompareOp = options.depthPrepass ? VK_COMPARE_OP_LESS_OR_EQUAL : VK_COMPARE_OP_LESS;
+			depthStencil.depthBoundsTestEnable = VK_FALSE;
+			depthStencil.stencilTestEnable = VK_FALSE;
+
 			VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
 			colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
 			colorBlendAttachment.blendEnable = VK_FALSE;
@@ -741,10 +1803,16 @@ class HelloTringleApplication
 
 			VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
 			pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-			pipelineLayoutInfo.setLayoutCount = 1;
-			pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
-			pipelineLayoutInfo.pushConstantRangeCount = 0; //optional
-			pipelineLayoutInfo.pPushConstantRanges = nullptr; //optional
+			//set 1 is the bindless texture table
+			std::array<VkDescriptorSetLayout, 2> setLayouts = {descriptorSetLayout, textureTableLayout};
+			pipelineLayoutInfo.setLayoutCount = bindlessSupported ? 2 : 1;
+			pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+			VkPushConstantRange pushConstantRange = {};
+			pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+			pushConstantRange.offset = 0;
+			pushConstantRange.size = sizeof(DrawPushConstants);
+			pipelineLayoutInfo.pushConstantRangeCount = 1;
+			pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
 
 			if(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
 			{
@@ -760,18 +1828,52 @@ class HelloTringleApplication
 			pipelineInfo.pViewportState = &viewportState;
 			pipelineInfo.pRasterizationState = &rasterizer;
 			pipelineInfo.pMultisampleState = &multisampling;
-			pipelineInfo.pDepthStencilState = nullptr; //optional
+			pipelineInfo.pDepthStencilState = &depthStencil;
 			pipelineInfo.pColorBlendState = &colorBlending;
-			pipelineInfo.pDepthStencilState = nullptr; //optional
+			pipelineInfo.pDynamicState = &dynamicState;
 			pipelineInfo.layout = pipelineLayout;
 			pipelineInfo.renderPass = renderPass;
-			pipelineInfo.subpass = 0;
+			pipelineInfo.subpass = options.depthPrepass ? 1 : 0;
 			pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; //optional
 			pipelineInfo.basePipelineIndex = -1; //optional
 
-			if(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS)
+			graphicsPipeline = createCachedGraphicsPipeline(pipelineInfo);
+
+			if(options.depthPrepass)
 			{
-				throw std::runtime_error("failed to creategraphics pipeline!");
+				//a position only vertex shader fetching just stream 0, no fragment shader and no colour attachment
+				auto depthVertShaderCode = readFile("shaders/vert_depth.spv");
+				VkShaderModule depthVertShaderModule = createShaderModule(depthVertShaderCode);
+				VkPipelineShaderStageCreateInfo depthVertShaderStageInfo = vertShaderStageInfo;
+				depthVertShaderStageInfo.module = depthVertShaderModule;
+
+				auto positionBindingDesciptions = vertexLayout.getBindingDescriptions(true);
+				auto positionAttributeDesciptions = vertexLayout.getAttributeDescriptions(true);
+
+				VkPipelineVertexInputStateCreateInfo positionInputInfo = vertexInputInfo;
+				positionInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(positionBindingDesciptions.size());
+				positionInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(positionAttributeDesciptions.size());
+				positionInputInfo.pVertexBindingDescriptions = positionBindingDesciptions.data();
+				positionInputInfo.pVertexAttributeDescriptions = positionAttributeDesciptions.data();
+
+				VkPipelineDepthStencilStateCreateInfo prepassDepthStencil = depthStencil;
+				prepassDepthStencil.depthWriteEnable = VK_TRUE;
+				prepassDepthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+
+				VkPipelineColorBlendStateCreateInfo prepassColorBlending = colorBlending;
+				prepassColorBlending.attachmentCount = 0;
+				prepassColorBlending.pAttachments = nullptr;
+
+				VkGraphicsPipelineCreateInfo prepassInfo = pipelineInfo;
+				prepassInfo.stageCount = 1;
+				prepassInfo.pStages = &depthVertShaderStageInfo;
+				prepassInfo.pVertexInputState = &positionInputInfo;
+				prepassInfo.pDepthStencilState = &prepassDepthStencil;
+				prepassInfo.pColorBlendState = &prepassColorBlending;
+				prepassInfo.subpass = 0;
+
+				depthPrepassPipeline = createCachedGraphicsPipeline(prepassInfo);
+				vkDestroyShaderModule(device, depthVertShaderModule, nullptr);
 			}
 
 			vkDestroyShaderModule(device, vertShaderModule, nullptr);
@@ -782,41 +1884,135 @@ class HelloTringleApplication
 
 		void createRenderPass()
 		{
+			//with msaa attachment 0 is the multisampled target, which is thrown away once it is resolved into attachment 2
+			bool multisampled = msaaSamples != VK_SAMPLE_COUNT_1_BIT;
+
 			VkAttachmentDescription colorAttachment = {};
 			colorAttachment.format = swapChainImageFormat;
-			colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+			colorAttachment.samples = msaaSamples;
 			colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-			colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+			colorAttachment.storeOp = multisampled ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
 			colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 			colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 			colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-			colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+			//offscreen targets are left ready to be copied back
+			colorAttachment.finalLayout = options.headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+			VkAttachmentDescription resolveAttachment = colorAttachment;
+			resolveAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+			resolveAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			resolveAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+			if(multisampled)
+			{
+				colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			}
+
+			VkAttachmentDescription depthAttachment = {};
+			depthAttachment.format = depthFormat;
+			depthAttachment.samples = msaaSamples;
+			depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+			depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
 			VkAttachmentReference colorAttachmentRef = {};
 			colorAttachmentRef.attachment = 0;
 			colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
-			VkSubpassDescription subpass = {};
-			subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-			subpass.colorAttachmentCount = 1;
-			subpass.pColorAttachments = &colorAttachmentRef;
+			VkAttachmentReference resolveAttachmentRef = {};
+			resolveAttachmentRef.attachment = 2;
+			resolveAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+			VkAttachmentReference depthAttachmentRef = {};
+			depthAttachmentRef.attachment = 1;
+			depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+			//the shading subpass only tests against the pre-pass depth
+			VkAttachmentReference readOnlyDepthAttachmentRef = {};
+			readOnlyDepthAttachmentRef.attachment = 1;
+			readOnlyDepthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+			//with the pre-pass subpass 0 only writes depth and subpass 1 shades, otherwise subpass 0 does both
+			uint32_t colorSubpass = options.depthPrepass ? 1 : 0;
+			std::array<VkSubpassDescription, 2> subpasses = {};
+			subpasses[0].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+			subpasses[0].pDepthStencilAttachment = &depthAttachmentRef;
+			subpasses[colorSubpass].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+			subpasses[colorSubpass].colorAttachmentCount = 1;
+			subpasses[colorSubpass].pColorAttachments = &colorAttachmentRef;
+			if(options.depthPrepass)
+			{
+				subpasses[colorSubpass].pDepthStencilAttachment = &readOnlyDepthAttachmentRef;
+			}
+			if(multisampled)
+			{
+				subpasses[colorSubpass].pResolveAttachments = &resolveAttachmentRef;
+			}
+
+			std::vector<VkAttachmentDescription> attachments = {colorAttachment, depthAttachment};
+			if(multisampled)
+			{
+				attachments.push_back(resolveAttachment);
+			}
 			VkRenderPassCreateInfo renderPassInfo = {};
 			renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-			renderPassInfo.attachmentCount = 1;
-			renderPassInfo.pAttachments = &colorAttachment;
-			renderPassInfo.subpassCount = 1;
-			renderPassInfo.pSubpasses = &subpass;
-
-			VkSubpassDependency dependancy = {};
-			dependancy.srcSubpass = VK_SUBPASS_EXTERNAL;
-			dependancy.dstSubpass = 0;
-			dependancy.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-			dependancy.srcAccessMask = 0;
-			dependancy.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-			dependancy.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-
-			renderPassInfo.dependencyCount = 1;
-			renderPassInfo.pDependencies = &dependancy;
+			renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+			renderPassInfo.pAttachments = attachments.data();
+			renderPassInfo.subpassCount = colorSubpass + 1;
+			renderPassInfo.pSubpasses = subpasses.data();
+
+			std::vector<VkSubpassDependency> dependancies;
+
+			VkSubpassDependency colorDependancy = {};
+			colorDependancy.srcSubpass = VK_SUBPASS_EXTERNAL;
+			colorDependancy.dstSubpass = colorSubpass;
+			colorDependancy.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+			//the multisampled target is shared by every frame in flight like the depth buffer
+			colorDependancy.srcAccessMask = multisampled ? VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT : 0;
+			colorDependancy.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+			colorDependancy.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+			dependancies.push_back(colorDependancy);
+
+			//the depth buffer is shared, the previous frame's depth tests finish before this frame clears it
+			VkSubpassDependency depthDependancy = {};
+			depthDependancy.srcSubpass = VK_SUBPASS_EXTERNAL;
+			depthDependancy.dstSubpass = 0;
+			depthDependancy.srcStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+			depthDependancy.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+			depthDependancy.dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+			depthDependancy.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+			dependancies.push_back(depthDependancy);
+
+			if(options.depthPrepass)
+			{
+				VkSubpassDependency prepassDependancy = {};
+				prepassDependancy.srcSubpass = 0;
+				prepassDependancy.dstSubpass = 1;
+				prepassDependancy.srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+				prepassDependancy.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+				prepassDependancy.dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+				prepassDependancy.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+				prepassDependancy.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+				dependancies.push_back(prepassDependancy);
+			}
+
+			//headless readback copies the image right after the render pass
+			if(options.headless)
+			{
+				VkSubpassDependency readbackDependancy = {};
+				readbackDependancy.srcSubpass = colorSubpass;
+				readbackDependancy.dstSubpass = VK_SUBPASS_EXTERNAL;
+				readbackDependancy.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+				readbackDependancy.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+				readbackDependancy.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+				readbackDependancy.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+				dependancies.push_back(readbackDependancy);
+			}
+
+			renderPassInfo.dependencyCount = static_cast<uint32_t>(dependancies.size());
+			renderPassInfo.pDependencies = dependancies.data();
 
 			if(vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_FALSE)
 			{
@@ -831,13 +2027,17 @@ class HelloTringleApplication
 
 			for(size_t i = 0; i < swapChainImageViews.size(); i++)
 			{
-				VkImageView attachments[] = {swapChainImageViews[i]};
+				std::vector<VkImageView> attachments = {swapChainImageViews[i], depthImageView};
+				if(colorImage != VK_NULL_HANDLE)
+				{
+					attachments = {colorImageView, depthImageView, swapChainImageViews[i]};
+				}
 
 				VkFramebufferCreateInfo framebufferInfo = {};
 				framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
 				framebufferInfo.renderPass = renderPass;
-				framebufferInfo.attachmentCount = 1;
-				framebufferInfo.pAttachments = attachments;
+				framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+				framebufferInfo.pAttachments = attachments.data();
 				framebufferInfo.width = swapChainExtent.width;
 				framebufferInfo.height = swapChainExtent.height;
 				framebufferInfo.layers = 1;
@@ -857,95 +2057,437 @@ class HelloTringleApplication
 			VkCommandPoolCreateInfo poolInfo = {};
 			poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
 			poolInfo.queueFamilyIndex = queueFamilyIndicies.graphicsFamily.value();
-			poolInfo.flags = 0; //optional
+			poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT; //the primary buffers are re-recorded every frame after a pool reset
+
+			commandPools.resize(frameSlotCount);
+			for(size_t i = 0; i < frameSlotCount; i++)
+			{
+				if(vkCreateCommandPool(device, &poolInfo, nullptr, &commandPools[i]) != VK_SUCCESS)
+				{
+					throw std::runtime_error("failed to create command pool!");
+				}
+			}
+			if(debug_log) std::cout << "> Created command pools\n";
+		}
+
+		//every worker thread gets one pool per frame in flight so recording never needs a lock
+		void createRecordingPools()
+		{
+			workers.init(RECORD_THREAD_COUNT);
+
+			QueueFamilyIndicies queueFamilyIndicies = findQueueFamilies(physicalDevice);
+
+			VkCommandPoolCreateInfo poolInfo = {};
+			poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+			poolInfo.queueFamilyIndex = queueFamilyIndicies.graphicsFamily.value();
+			poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT; //reset as a whole whenever the frame's draws are re-recorded
+
+			recordingPools.resize(frameSlotCount);
+			recordedDraws.resize(frameSlotCount);
+			for(auto& framePools : recordingPools)
+			{
+				framePools.resize(workers.getWorkerSlotCount());
+				for(auto& recordingPool : framePools)
+				{
+					if(vkCreateCommandPool(device, &poolInfo, nullptr, &recordingPool.pool) != VK_SUCCESS)
+					{
+						throw std::runtime_error("failed to create command pool!");
+					}
+				}
+			}
+			if(debug_log) std::cout << "> Created " << workers.getWorkerSlotCount() << " recording command pools per frame\n";
+		}
+
+		//fragment shader invocations divided by the rendered pixels is the overdraw, at most one query per recording worker
+		void createStatisticsQueryPools()
+		{
+			statisticsQueryCounts.assign(frameSlotCount, 0);
+			statisticsSubmittedCounts.assign(frameSlotCount, 0);
+			if(!pipelineStatisticsSupported)
+			{
+				return;
+			}
+
+			VkQueryPoolCreateInfo queryPoolInfo = {};
+			queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+			queryPoolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+			queryPoolInfo.queryCount = workers.getWorkerSlotCount();
+			queryPoolInfo.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+			statisticsQueryPools.resize(frameSlotCount);
+			for(auto& queryPool : statisticsQueryPools)
+			{
+				if(vkCreateQueryPool(device, &queryPoolInfo, nullptr, &queryPool) != VK_SUCCESS)
+				{
+					throw std::runtime_error("failed to create query pool!");
+				}
+			}
+		}
+
+		//called once the frame slot's previous frame has completed, so the results are available without waiting
+		void resolvePipelineStatistics(size_t frame)
+		{
+			uint32_t queryCount = statisticsSubmittedCounts[frame];
+			if(queryCount == 0)
+			{
+				return;
+			}
+			statisticsSubmittedCounts[frame] = 0;
+
+			std::vector<uint64_t> invocations(queryCount);
+			if(vkGetQueryPoolResults(device, statisticsQueryPools[frame], 0, queryCount, invocations.size() * sizeof(uint64_t), invocations.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+			{
+				return;
+			}
+			for(uint64_t count : invocations)
+			{
+				fragmentInvocationsTotal += count;
+			}
+			pixelsTotal += static_cast<uint64_t>(swapChainExtent.width) * swapChainExtent.height;
+			statisticsFrameCount++;
+		}
+
+		//hands out the next free secondary buffer of a worker's pool, only called from the thread owning the pool
+		VkCommandBuffer acquireSecondaryCommandBuffer(RecordingPool& recordingPool)
+		{
+			if(recordingPool.used == recordingPool.buffers.size())
+			{
+				VkCommandBufferAllocateInfo allocInfo = {};
+				allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+				allocInfo.commandPool = recordingPool.pool;
+				allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+				allocInfo.commandBufferCount = 1;
+
+				VkCommandBuffer commandBuffer;
+				if(vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS)
+				{
+					throw std::runtime_error("failed to allocate command buffers!");
+				}
+				recordingPool.buffers.push_back(commandBuffer);
+			}
+			return recordingPool.buffers[recordingPool.used++];
+		}
+
+		void resetRecordingPools(size_t frame)
+		{
+			for(auto& recordingPool : recordingPools[frame])
+			{
+				vkResetCommandPool(device, recordingPool.pool, 0);
+				recordingPool.used = 0;
+			}
+		}
 
-			if(vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
+		//forces every frame in flight to re-record its scene draws, e.g. after the pipeline or extent changed
+		void invalidateRecordedDraws()
+		{
+			for(auto& recorded : recordedDraws)
 			{
-				throw std::runtime_error("failed to create command pool!");
+				recorded.valid = false;
 			}
-			if(debug_log) std::cout << "> Created command pool\n";
 		}
 
 		void createCommandBuffers()
 		{
-			commandBuffers.resize(swapchainFramebuffers.size());
-			
-			VkCommandBufferAllocateInfo allocInfo = {};
-			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-			allocInfo.commandPool = commandPool;
-			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-			allocInfo.commandBufferCount = (uint32_t) commandBuffers.size();
+			commandBuffers.resize(frameSlotCount);
+
+			for(size_t i = 0; i < frameSlotCount; i++)
+			{
+				VkCommandBufferAllocateInfo allocInfo = {};
+				allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+				allocInfo.commandPool = commandPools[i];
+				allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+				allocInfo.commandBufferCount = 1;
+
+				if(vkAllocateCommandBuffers(device, &allocInfo, &commandBuffers[i]) != VK_SUCCESS)
+				{
+					throw std::runtime_error("failed to allocate command buffers!");
+				}
+			}
+			if(debug_log) std::cout << "> Created command buffers\n";
+		}
+
+		//the scene draws are split into ranges recorded in parallel into secondary command buffers
+		//they are kept while the scene and this frame's camera offset are unchanged, returns false if they were reused
+		bool recordSceneCommandBuffers()
+		{
+			RecordedDraws& recorded = recordedDraws[currentFrame];
+			if(recorded.valid && recorded.sceneVersion == sceneVersion && recorded.uniformOffset == cameraUniformOffset)
+			{
+				return false;
+			}
+
+			//the slot wait in drawFrame guarantees none of this frame's secondaries are still pending
+			resetRecordingPools(currentFrame);
+
+			uint32_t objectCount = static_cast<uint32_t>(sceneObjects.size());
+			uint32_t taskCount = std::max(1u, std::min(workers.getWorkerSlotCount(), (objectCount + MIN_INSTANCES_PER_RECORDING_TASK - 1) / MIN_INSTANCES_PER_RECORDING_TASK));
+			if(options.gpuCulling)
+			{
+				//the indirect draws cover every instance, recording no longer depends on the object count
+				taskCount = 1;
+			}
+			uint32_t drawsPerTask = (objectCount + taskCount - 1) / taskCount;
 
-			if(vkAllocateCommandBuffers(device, &allocInfo, commandBuffers.data()) != VK_SUCCESS)
+			recorded.commandBuffers.resize(taskCount);
+			recorded.prepassCommandBuffers.resize(options.depthPrepass ? taskCount : 0);
+			workers.parallelFor(taskCount, [&](uint32_t task, uint32_t worker)
+			{
+				uint32_t firstObject = std::min(objectCount, task * drawsPerTask);
+				uint32_t endObject = std::min(objectCount, firstObject + drawsPerTask);
+				if(options.depthPrepass)
+				{
+					VkCommandBuffer prepass = acquireSecondaryCommandBuffer(recordingPools[currentFrame][worker]);
+					recordSceneDraws(prepass, firstObject, endObject, 0, NO_QUERY);
+					recorded.prepassCommandBuffers[task] = prepass;
+				}
+				VkCommandBuffer secondary = acquireSecondaryCommandBuffer(recordingPools[currentFrame][worker]);
+				recordSceneDraws(secondary, firstObject, endObject, options.depthPrepass ? 1 : 0, pipelineStatisticsSupported ? task : NO_QUERY);
+				recorded.commandBuffers[task] = secondary;
+			});
+			statisticsQueryCounts[currentFrame] = pipelineStatisticsSupported ? taskCount : 0;
+
+			recorded.valid = true;
+			recorded.sceneVersion = sceneVersion;
+			recorded.uniformOffset = cameraUniformOffset;
+			return true;
+		}
+
+		//the primary buffer only runs the render pass and executes this frame's scene secondaries in order
+		void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex)
+		{
+			const std::vector<VkCommandBuffer>& secondaryCommandBuffers = recordedDraws[currentFrame].commandBuffers;
+
+			VkCommandBufferBeginInfo beginInfo = {};
+			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+			beginInfo.pInheritanceInfo = nullptr; //optional
+
+			if(vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
 			{
 				throw std::runtime_error("failed to begin recording command buffer!");
 			}
 
-			for(size_t i = 0; i < commandBuffers.size(); i++)
+			VkRenderPassBeginInfo renderPassInfo = {};
+			renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+			renderPassInfo.renderPass = renderPass;
+			renderPassInfo.framebuffer = swapchainFramebuffers[imageIndex];
+			renderPassInfo.renderArea = {0, 0};
+			renderPassInfo.renderArea.extent = swapChainExtent;
+
+			std::array<VkClearValue, 2> clearValues = {};
+			clearValues[0].color = {0.0f, 0.0f, 0.0f, 1.0f}; //black
+			clearValues[1].depthStencil = {1.0f, 0};
+
+			renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+			renderPassInfo.pClearValues = clearValues.data();
+
+			profiler.resetGpuZones(commandBuffer);
+
+			if(options.gpuCulling)
+			{
+				uint32_t cullZone = profiler.beginGpuZone(commandBuffer, "culling");
+				recordCulling(commandBuffer);
+				profiler.endGpuZone(commandBuffer, cullZone);
+			}
+
+			//the reused secondaries begin their queries again every frame
+			if(statisticsQueryCounts[currentFrame] > 0)
 			{
-				VkCommandBufferBeginInfo beginInfo = {};
-				beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-				beginInfo.flags = 0; //optional
-				beginInfo.pInheritanceInfo = nullptr; //optional
+				vkCmdResetQueryPool(commandBuffer, statisticsQueryPools[currentFrame], 0, statisticsQueryCounts[currentFrame]);
+			}
+			statisticsSubmittedCounts[currentFrame] = statisticsQueryCounts[currentFrame];
+
+			uint32_t renderPassZone = profiler.beginGpuZone(commandBuffer, "render pass");
 
-				if(vkBeginCommandBuffer(commandBuffers[i], &beginInfo) != VK_SUCCESS)
+			vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+			if(options.depthPrepass)
+			{
+				const std::vector<VkCommandBuffer>& prepassCommandBuffers = recordedDraws[currentFrame].prepassCommandBuffers;
+				vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(prepassCommandBuffers.size()), prepassCommandBuffers.data());
+				vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+			}
+			vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(secondaryCommandBuffers.size()), secondaryCommandBuffers.data());
+			vkCmdEndRenderPass(commandBuffer);
+
+			profiler.endGpuZone(commandBuffer, renderPassZone);
+
+			if(isReadbackFrame())
+			{
+				uint32_t readbackZone = profiler.beginGpuZone(commandBuffer, "readback copy");
+				recordReadback(commandBuffer, imageIndex);
+				profiler.endGpuZone(commandBuffer, readbackZone);
+			}
+
+			if(vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to record command buffer!");
+			}
+		}
+
+		//resets this frame's draw commands, culls every instance and makes the results visible to the indirect draws
+		void recordCulling(VkCommandBuffer commandBuffer)
+		{
+			VkBuffer drawCommands = drawCommandBuffers[currentFrame];
+			VkDeviceSize commandsSize = sizeof(VkDrawIndexedIndirectCommand) * meshSubmeshes.size();
+
+			//the slot wait in drawFrame guarantees the previous draws from this buffer are done
+			VkBufferCopy resetRegion = {};
+			resetRegion.size = commandsSize;
+			vkCmdCopyBuffer(commandBuffer, drawTemplateBuffer, drawCommands, 1, &resetRegion);
+
+			VkBufferMemoryBarrier barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.buffer = drawCommands;
+			barrier.offset = 0;
+			barrier.size = commandsSize;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+			uint32_t objectCount = static_cast<uint32_t>(sceneObjects.size());
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline);
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipelineLayout, 0, 1, &cullDescriptorSets[currentFrame], 1, &cullUniformOffset);
+			vkCmdDispatch(commandBuffer, (objectCount + CULL_WORKGROUP_SIZE - 1) / CULL_WORKGROUP_SIZE, 1, 1);
+
+			//the shader only counts into the first command, every submesh draws the same instances
+			VkPipelineStageFlags srcStages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+			VkAccessFlags srcAccess = VK_ACCESS_SHADER_WRITE_BIT;
+			if(meshSubmeshes.size() > 1)
+			{
+				barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+				barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+				vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+				std::vector<VkBufferCopy> countCopies(meshSubmeshes.size() - 1);
+				for(size_t i = 0; i < countCopies.size(); i++)
 				{
-					throw std::runtime_error("failed to begin recording command buffers!");
+					countCopies[i].srcOffset = offsetof(VkDrawIndexedIndirectCommand, instanceCount);
+					countCopies[i].dstOffset = sizeof(VkDrawIndexedIndirectCommand) * (i + 1) + offsetof(VkDrawIndexedIndirectCommand, instanceCount);
+					countCopies[i].size = sizeof(uint32_t);
 				}
+				vkCmdCopyBuffer(commandBuffer, drawCommands, drawCommands, static_cast<uint32_t>(countCopies.size()), countCopies.data());
 
-				VkRenderPassBeginInfo renderPassInfo = {};
-				renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-				renderPassInfo.renderPass = renderPass;
-				renderPassInfo.framebuffer = swapchainFramebuffers[i];
-				renderPassInfo.renderArea = {0, 0};
-				renderPassInfo.renderArea.extent = swapChainExtent;
+				srcStages |= VK_PIPELINE_STAGE_TRANSFER_BIT;
+				srcAccess |= VK_ACCESS_TRANSFER_WRITE_BIT;
+			}
 
-				VkClearValue clearColor = {0.0f, 0.0f, 0.0f, 1.0f}; //black
+			VkMemoryBarrier memoryBarrier = {};
+			memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			memoryBarrier.srcAccessMask = srcAccess;
+			memoryBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+			vkCmdPipelineBarrier(commandBuffer, srcStages, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+		}
 
-				renderPassInfo.clearValueCount = 1;
-				renderPassInfo.pClearValues = &clearColor;
+		//records the draws of sceneObjects[firstObject, endObject) into a secondary buffer continuing the render pass
+		//runs on worker threads, so it only reads shared state
+		//subpass 0 of a depth pre-pass render pass gets the depth only pipeline, query is a slot in this frame's statistics pool or NO_QUERY
+		void recordSceneDraws(VkCommandBuffer commandBuffer, uint32_t firstObject, uint32_t endObject, uint32_t subpass, uint32_t query)
+		{
+			//no framebuffer so the buffer is valid for whichever swapchain image the frame acquires
+			VkCommandBufferInheritanceInfo inheritanceInfo = {};
+			inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+			inheritanceInfo.renderPass = renderPass;
+			inheritanceInfo.subpass = subpass;
+			inheritanceInfo.framebuffer = VK_NULL_HANDLE;
+
+			//not one time submit, the buffer is resubmitted by later frames while the draws are unchanged
+			VkCommandBufferBeginInfo beginInfo = {};
+			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+			beginInfo.pInheritanceInfo = &inheritanceInfo;
 
-				vkCmdBeginRenderPass(commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-				vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+			if(vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to begin recording command buffer!");
+			}
 
-				VkBuffer vertexBuffers[] = {vertexBuffer};
-				VkDeviceSize offsets[] = {0};
-				vkCmdBindVertexBuffers(commandBuffers[i], 0, 1, vertexBuffers, offsets);
+			bool prepass = options.depthPrepass && subpass == 0;
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, prepass ? depthPrepassPipeline : graphicsPipeline);
 
-				vkCmdBindIndexBuffer(commandBuffers[i], indexBuffer, 0, VK_INDEX_TYPE_UINT16);
+			VkViewport viewport = {};
+			viewport.x = 0.0f;
+			viewport.y = 0.0f;
+			viewport.width = (float) swapChainExtent.width;
+			viewport.height = (float) swapChainExtent.height;
+			viewport.minDepth = 0.0f;
+			viewport.maxDepth = 1.0f;
+			vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
 
-				vkCmdBindDescriptorSets(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[i], 0, nullptr);
-				vkCmdDrawIndexed(commandBuffers[i], static_cast<uint32_t>(indicies.size()), 1, 0, 0, 0);
-				
-				vkCmdEndRenderPass(commandBuffers[i]);
+			VkRect2D scissor = {};
+			scissor.offset = {0, 0};
+			scissor.extent = swapChainExtent;
+			vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-				if(vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS)
+			//the depth only pipeline fetches nothing but the position stream
+			std::array<VkBuffer, VertexLayout::MAX_STREAMS> vertexBuffers;
+			vertexBuffers.fill(vertexBuffer);
+			uint32_t streamCount = prepass ? 1 : vertexLayout.getStreamCount();
+			vkCmdBindVertexBuffers(commandBuffer, 0, streamCount, vertexBuffers.data(), vertexStreamOffsets.data());
+
+			vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, meshIndexType);
+
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[currentFrame], 1, &cameraUniformOffset);
+			if(bindlessSupported)
+			{
+				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, 1, &textureTableSet, 0, nullptr);
+			}
+			vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(DrawPushConstants), &meshDrawConstants);
+			if(query != NO_QUERY)
+			{
+				vkCmdBeginQuery(commandBuffer, statisticsQueryPools[currentFrame], query, 0);
+			}
+			if(options.gpuCulling)
+			{
+				//instance counts come from the cull pass recorded into this frame's primary buffer
+				uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+				if(multiDrawIndirectSupported)
+				{
+					vkCmdDrawIndexedIndirect(commandBuffer, drawCommandBuffers[currentFrame], 0, static_cast<uint32_t>(meshSubmeshes.size()), stride);
+				}
+				else
+				{
+					for(uint32_t i = 0; i < meshSubmeshes.size(); i++)
+					{
+						vkCmdDrawIndexedIndirect(commandBuffer, drawCommandBuffers[currentFrame], i * stride, 1, stride);
+					}
+				}
+			}
+			else
+			{
+				//gl_InstanceIndex includes firstInstance so every range reads its own part of the instance buffer
+				for(const MeshSubmesh& submesh : meshSubmeshes)
 				{
-					throw std::runtime_error("failed to record command buffers!");
+					vkCmdDrawIndexed(commandBuffer, submesh.indexCount, endObject - firstObject, submesh.firstIndex, submesh.vertexOffset, firstObject);
 				}
 			}
-			if(debug_log) std::cout << "> Created command buffers\n";
+			if(query != NO_QUERY)
+			{
+				vkCmdEndQuery(commandBuffer, statisticsQueryPools[currentFrame], query);
+			}
+
+			if(vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to record command buffer!");
+			}
 		}
 
 		void createSyncObjects()
 		{
-			imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-			renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-			inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-			imagesInFlight.resize(swapChainImages.size(), VK_NULL_HANDLE);
+			imageAvailableSemaphores.resize(frameSlotCount);
+			renderFinishedSemaphores.resize(frameSlotCount);
+			imageFrames.assign(swapChainImages.size(), NO_FRAME);
 
 			VkSemaphoreCreateInfo semaphoreInfo = {};
 			semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-			VkFenceCreateInfo fenceInfo = {};
-			fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-			fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
-			for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+			//the swapchain only works with binary semaphores, everything else waits on the scheduler's timeline
+			frameScheduler.init(device, getProfileFramesInFlight(presentProfile));
+			for (size_t i = 0; i < frameSlotCount; i++)
 			{
 			if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS ||
-				vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS ||
-				vkCreateFence(device, &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS)
+				vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS)
 				{
 					throw std::runtime_error("failed to create synchronization objects for a frame!");
 				}
@@ -953,47 +2495,119 @@ class HelloTringleApplication
 			if(debug_log) std::cout << "> Created sync objects\n";
 		}
 
-		void createVertexBuffer()
+		//maps the mesh file if one was given, otherwise describes the built in quad as a single submesh
+		void loadMesh()
 		{
-			VkDeviceSize bufferSize = sizeof(vertecies[0]) * vertecies.size();
-			
-			VkBuffer stagingBuffer;
-			VkDeviceMemory stagingbufferMemory;
-			createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingbufferMemory);
+			glm::vec3 boundsMin;
+			glm::vec3 boundsMax;
 
-			void* data;
-			vkMapMemory(device, stagingbufferMemory, 0, bufferSize, 0, &data);
-			memcpy(data, vertecies.data(), (size_t) bufferSize);
-			vkUnmapMemory(device, stagingbufferMemory);
+			if(options.meshPath.empty())
+			{
+				MeshSubmesh submesh = {};
+				submesh.indexCount = static_cast<uint32_t>(indicies.size());
+				meshSubmeshes = {submesh};
+				meshIndexType = VK_INDEX_TYPE_UINT16;
 
-			createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, vertexBufferMemory);
+				boundsMin = boundsMax = vertecies[0].pos;
+				for(const Vertex& vertex : vertecies)
+				{
+					boundsMin = glm::min(boundsMin, vertex.pos);
+					boundsMax = glm::max(boundsMax, vertex.pos);
+				}
+				meshVertexSource.data = vertecies.data();
+				meshVertexSource.count = static_cast<uint32_t>(vertecies.size());
+			}
+			else
+			{
+				meshFile.open(options.meshPath);
+				const MeshFileHeader& header = meshFile.header();
+				if(!meshMatchesVertexLayout(meshFile))
+				{
+					throw std::runtime_error("mesh " + options.meshPath + " does not match the vertex layout!");
+				}
 
-			copyBuffer(stagingBuffer, vertexBuffer, bufferSize);
+				VkPhysicalDeviceProperties deviceProperties;
+				vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+				if(header.indexSize == 4 && header.vertexCount > deviceProperties.limits.maxDrawIndexedIndexValue)
+				{
+					throw std::runtime_error("mesh " + options.meshPath + " has more vertices than the device can index!");
+				}
 
-			vkDestroyBuffer(device, stagingBuffer, nullptr);
-			vkFreeMemory(device, stagingbufferMemory, nullptr);
-			if(debug_log) std::cout << "> Created vertex buffers\n";
+				meshSubmeshes.assign(meshFile.submeshes(), meshFile.submeshes() + header.submeshCount);
+				meshIndexType = header.indexSize == 2 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+				boundsMin = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+				boundsMax = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+				meshVertexSource.data = meshFile.vertexData();
+				meshVertexSource.count = header.vertexCount;
+			}
+			meshVertexSource.stride = sizeof(Vertex);
+			meshVertexSource.positionOffset = offsetof(Vertex, pos);
+			meshVertexSource.colorOffset = offsetof(Vertex, color);
+			meshVertexSource.texCoordOffset = offsetof(Vertex, texCoord);
+			for(int axis = 0; axis < 3; axis++)
+			{
+				meshVertexSource.boundsMin[axis] = boundsMin[axis];
+				meshVertexSource.boundsMax[axis] = boundsMax[axis];
+			}
+
+			glm::vec3 size = boundsMax - boundsMin;
+			float largestSide = std::max(size.x, std::max(size.y, size.z));
+			meshCenter = (boundsMin + boundsMax) * 0.5f;
+			meshScale = largestSide > 0.0f ? 1.0f / largestSide : 1.0f;
+			meshRadius = glm::length(size) * 0.5f;
+			meshTransform = glm::scale(glm::mat4(1.0f), glm::vec3(meshScale));
+			meshTransform = glm::translate(meshTransform, -meshCenter);
+
+			//quantized positions are relative to the bounds, scaling them back costs nothing in the model matrix
+			float dequantizeScale[3];
+			float dequantizeOffset[3];
+			vertexLayout.getPositionDequantize(meshVertexSource, dequantizeScale, dequantizeOffset);
+			meshDrawConstants.model = glm::translate(meshTransform, glm::vec3(dequantizeOffset[0], dequantizeOffset[1], dequantizeOffset[2]));
+			meshDrawConstants.model = glm::scale(meshDrawConstants.model, glm::vec3(dequantizeScale[0], dequantizeScale[1], dequantizeScale[2]));
+			if(debug_log) std::cout << "> Loaded mesh with " << meshSubmeshes.size() << " submeshes\n";
 		}
 
-		void createIndexBuffer()
+		void createVertexBuffer()
 		{
-			VkDeviceSize bufferSize = sizeof(indicies[0]) * indicies.size();
+			//a layout matching the mesh file is read straight out of the mapping into the staging ring, any other is packed first
+			const void* data = meshVertexSource.data;
+			VkDeviceSize bufferSize = static_cast<VkDeviceSize>(meshVertexSource.stride) * meshVertexSource.count;
+			std::vector<uint8_t> packed;
+			if(vertexLayout.matchesSource(meshVertexSource))
+			{
+				vertexStreamOffsets = {0};
+			}
+			else
+			{
+				vertexLayout.pack(meshVertexSource, packed);
+				vertexStreamOffsets = vertexLayout.getStreamOffsets(meshVertexSource.count);
+				data = packed.data();
+				bufferSize = packed.size();
+			}
+			benchmark.setValue("vertex_buffer_kib", bufferSize / 1024.0);
 
-			VkBuffer stagingBuffer;
-			VkDeviceMemory stagingbufferMemory;
-			createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingbufferMemory);
+			createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, vertexBufferAllocation);
+
+			uploader.uploadBuffer(vertexBuffer, 0, data, bufferSize, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+			if(debug_log) std::cout << "> Created vertex buffers, " << bufferSize << " bytes in the " << getVertexLayoutName(vertexLayout.getPreset()) << " layout\n";
+		}
 
-			void* data;
-			vkMapMemory(device, stagingbufferMemory, 0, bufferSize, 0, &data);
-			memcpy(data, indicies.data(), (size_t) bufferSize);
-			vkUnmapMemory(device, stagingbufferMemory);
+		void createIndexBuffer()
+		{
+			const void* data = indicies.data();
+			VkDeviceSize bufferSize = sizeof(indicies[0]) * indicies.size();
+			if(meshFile.isOpen())
+			{
+				data = meshFile.indexData();
+				bufferSize = meshFile.header().indexDataSize;
+			}
 
-			createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexBufferMemeory);
+			createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexBufferAllocation);
 
-			copyBuffer(stagingBuffer, indexBuffer, bufferSize);
+			uploader.uploadBuffer(indexBuffer, 0, data, bufferSize, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT);
 
-			vkDestroyBuffer(device, stagingBuffer, nullptr);
-			vkFreeMemory(device, stagingbufferMemory, nullptr);
+			//uploadBuffer has copied everything into the staging ring by the time it returns
+			meshFile.close();
 			if(debug_log) std::cout << "> Created index buffers\n";
 		}
 
@@ -1001,7 +2615,7 @@ class HelloTringleApplication
 		{
 			VkDescriptorSetLayoutBinding uboLayoutBinding = {};
 			uboLayoutBinding.binding = 0;
-			uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+			uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 			uboLayoutBinding.descriptorCount = 1;
 			uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 			uboLayoutBinding.pImmutableSamplers = nullptr; //optional
@@ -1013,85 +2627,249 @@ class HelloTringleApplication
 			samplerLayoutBinding.pImmutableSamplers = nullptr;
 			samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 			
-			std::array<VkDescriptorSetLayoutBinding, 2> bindings = {uboLayoutBinding, samplerLayoutBinding};
-			VkDescriptorSetLayoutCreateInfo layoutInfo = {};
-			layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-			layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
-			layoutInfo.pBindings = bindings.data();
+			VkDescriptorSetLayoutBinding instanceLayoutBinding = {};
+			instanceLayoutBinding.binding = 2;
+			instanceLayoutBinding.descriptorCount = 1;
+			instanceLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			instanceLayoutBinding.pImmutableSamplers = nullptr;
+			instanceLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+			
+			VkDescriptorSetLayoutBinding visibleLayoutBinding = {};
+			visibleLayoutBinding.binding = 3;
+			visibleLayoutBinding.descriptorCount = 1;
+			visibleLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			visibleLayoutBinding.pImmutableSamplers = nullptr;
+			visibleLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+			
+			descriptorLayoutCache.init(device);
+			descriptorSetLayout = descriptorLayoutCache.getLayout({uboLayoutBinding, samplerLayoutBinding, instanceLayoutBinding, visibleLayoutBinding});
 
-			if(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
+			if(bindlessSupported)
 			{
-				throw std::runtime_error("failed to create descriptor layout!");
+				createTextureTableLayout();
+			}
+
+			if(options.gpuCulling)
+			{
+				//cull uniforms, instances, visible instance indices, draw commands
+				std::vector<VkDescriptorSetLayoutBinding> cullBindings(4);
+				for(uint32_t i = 0; i < cullBindings.size(); i++)
+				{
+					cullBindings[i].binding = i;
+					cullBindings[i].descriptorCount = 1;
+					cullBindings[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+					cullBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+				}
+				cullDescriptorSetLayout = descriptorLayoutCache.getLayout(cullBindings);
 			}
 		}
 
-		void createUniformBuffers()
+		void createScene()
 		{
-			VkDeviceSize bufferSize = sizeof(UniformBufferObject);
+			//lay the objects out on a square grid around the origin
+			uint32_t objectCount = std::max(1u, options.instanceCount);
+			uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(objectCount))));
+			float spacing = 1.2f;
 
-			uniformBuffers.resize(swapChainImages.size());
-			uniformBufferMemory.resize(swapChainImages.size());
+			sceneObjects.resize(objectCount);
+			for(uint32_t i = 0; i < objectCount; i++)
+			{
+				float x = (static_cast<float>(i % side) - (side - 1) / 2.0f) * spacing;
+				float y = (static_cast<float>(i / side) - (side - 1) / 2.0f) * spacing;
+				sceneObjects[i].position = glm::vec3(x, y, 0.0f);
+
+				//a single object keeps the plain texture, larger scenes get a slight per instance tint
+				float shade = objectCount == 1 ? 1.0f : 0.7f + 0.3f * ((i * 2654435761u) % 1000) / 999.0f;
+				sceneObjects[i].tint = glm::vec4(shade, 1.0f - (1.0f - shade) * 0.5f, 1.0f, 1.0f);
+				sceneObjects[i].texture = i % static_cast<uint32_t>(options.texturePaths.size());
+			}
 
-			for(size_t i = 0; i < swapChainImages.size(); i++)
+			//pull the camera back far enough to see the whole grid
+			cameraDistance = std::max(1.0f, side * spacing / 1.2f);
+			sceneVersion++;
+		}
+
+		void createInstanceBuffers()
+		{
+			VkDeviceSize bufferSize = sizeof(InstanceData) * sceneObjects.size();
+
+			instanceBuffers.resize(frameSlotCount);
+			instanceAllocations.resize(frameSlotCount);
+			for(size_t i = 0; i < frameSlotCount; i++)
 			{
-				createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformBuffers[i], uniformBufferMemory[i]);
+				createBuffer(bufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, instanceBuffers[i], instanceAllocations[i]);
 			}
+			instanceVersions.assign(frameSlotCount, 0);
+			if(debug_log) std::cout << "> Created instance buffers for " << sceneObjects.size() << " instances\n";
+		}
+
+		//one partially bound array of combined image samplers, sized to what the device allows up to MAX_BINDLESS_TEXTURES
+		void createTextureTableLayout()
+		{
+			VkPhysicalDeviceVulkan12Properties properties12 = {};
+			properties12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+			VkPhysicalDeviceProperties2 properties2 = {};
+			properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+			properties2.pNext = &properties12;
+			vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+
+			textureTableSize = std::min({MAX_BINDLESS_TEXTURES, properties12.maxPerStageDescriptorUpdateAfterBindSampledImages, properties12.maxDescriptorSetUpdateAfterBindSampledImages, properties12.maxPerStageDescriptorUpdateAfterBindSamplers, properties12.maxDescriptorSetUpdateAfterBindSamplers});
+
+			VkDescriptorSetLayoutBinding tableBinding = {};
+			tableBinding.binding = 0;
+			tableBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			tableBinding.descriptorCount = textureTableSize;
+			tableBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+			VkDescriptorBindingFlags bindingFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+			textureTableLayout = descriptorLayoutCache.getLayout({tableBinding}, {bindingFlags}, VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT);
+			if(debug_log) std::cout << "> Created bindless texture table layout with " << textureTableSize << " slots\n";
 		}
 
-		void createDescriptorPool()
+		//the table gets an allocator of its own because update after bind sets need a pool created for them
+		void createTextureTable()
 		{
-			std::array<VkDescriptorPoolSize, 2> poolSizes = {};
-			poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-			poolSizes[0].descriptorCount = static_cast<uint32_t>(swapChainImages.size());
-			poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-			poolSizes[1].descriptorCount = static_cast<uint32_t>(swapChainImages.size());
+			textureTableAllocator.init(device, {{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, static_cast<float>(textureTableSize)}}, 1, VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT);
+			textureTableSet = textureTableAllocator.allocate(textureTableLayout);
 
-			VkDescriptorPoolCreateInfo poolInfo = {};
-			poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-			poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-			poolInfo.pPoolSizes = poolSizes.data();
-			poolInfo.maxSets = static_cast<uint32_t>(swapChainImages.size());
+			writeTextureTableSlot(0, placeholderImageView);
+		}
+
+		void createCullPipeline()
+		{
+			if(!options.gpuCulling)
+			{
+				return;
+			}
+
+			auto cullShaderCode = readFile("shaders/cull.spv");
+			VkShaderModule cullShaderModule = createShaderModule(cullShaderCode);
+
+			VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+			pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+			pipelineLayoutInfo.setLayoutCount = 1;
+			pipelineLayoutInfo.pSetLayouts = &cullDescriptorSetLayout;
+
+			if(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &cullPipelineLayout) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create pipeline layout!");
+			}
+
+			VkComputePipelineCreateInfo pipelineInfo = {};
+			pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+			pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+			pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+			pipelineInfo.stage.module = cullShaderModule;
+			pipelineInfo.stage.pName = "main";
+			pipelineInfo.layout = cullPipelineLayout;
 
-			if(vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+			if(vkCreateComputePipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &cullPipeline) != VK_SUCCESS)
 			{
-				throw std::runtime_error("failed to create descriptor pool!");
+				throw std::runtime_error("failed to create cull pipeline!");
 			}
+
+			vkDestroyShaderModule(device, cullShaderModule, nullptr);
+			if(debug_log) std::cout << "> Created cull pipeline\n";
 		}
 
-		void createDescriptorSets()
+		void createCullingBuffers()
 		{
-			std::vector<VkDescriptorSetLayout> layouts(swapChainImages.size(), descriptorSetLayout);
-			VkDescriptorSetAllocateInfo allocInfo = {};
-			allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-			allocInfo.descriptorPool = descriptorPool;
-			allocInfo.descriptorSetCount = static_cast<uint32_t>(swapChainImages.size());
-			allocInfo.pSetLayouts = layouts.data();
+			if(!options.gpuCulling)
+			{
+				return;
+			}
+
+			VkDeviceSize visibleSize = sizeof(uint32_t) * sceneObjects.size();
+			VkDeviceSize commandsSize = sizeof(VkDrawIndexedIndirectCommand) * meshSubmeshes.size();
 
-			descriptorSets.resize(swapChainImages.size());
-			if(vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) != VK_SUCCESS)
+			visibleInstanceBuffers.resize(frameSlotCount);
+			visibleInstanceAllocations.resize(frameSlotCount);
+			drawCommandBuffers.resize(frameSlotCount);
+			drawCommandAllocations.resize(frameSlotCount);
+			for(size_t i = 0; i < frameSlotCount; i++)
 			{
-				throw std::runtime_error("failed to allocate descriptor sets!");
+				createBuffer(visibleSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, visibleInstanceBuffers[i], visibleInstanceAllocations[i]);
+				createBuffer(commandsSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, drawCommandBuffers[i], drawCommandAllocations[i]);
 			}
 
-			for(size_t i = 0; i < swapChainImages.size(); i++)
+			std::vector<VkDrawIndexedIndirectCommand> commands(meshSubmeshes.size());
+			for(size_t i = 0; i < meshSubmeshes.size(); i++)
+			{
+				commands[i].indexCount = meshSubmeshes[i].indexCount;
+				commands[i].instanceCount = 0;
+				commands[i].firstIndex = meshSubmeshes[i].firstIndex;
+				commands[i].vertexOffset = meshSubmeshes[i].vertexOffset;
+				commands[i].firstInstance = 0;
+			}
+
+			createBuffer(commandsSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, drawTemplateBuffer, drawTemplateAllocation);
+			uploader.uploadBuffer(drawTemplateBuffer, 0, commands.data(), commandsSize, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+			if(debug_log) std::cout << "> Created culling buffers\n";
+		}
+
+		void createUniformBuffers()
+		{
+			VkPhysicalDeviceProperties deviceProperties;
+			vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+			uniformRings.resize(frameSlotCount);
+
+			for(size_t i = 0; i < frameSlotCount; i++)
+			{
+				createBuffer(UNIFORM_RING_SIZE, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformRings[i].buffer, uniformRings[i].allocation);
+				uniformRings[i].capacity = UNIFORM_RING_SIZE;
+				uniformRings[i].alignment = deviceProperties.limits.minUniformBufferOffsetAlignment;
+			}
+		}
+
+		void createDescriptorAllocators()
+		{
+			//pools are sized per set from the mix the scene and cull sets use, a pool that runs out is followed by a larger one
+			std::vector<DescriptorPoolRatio> ratios = {
+				{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f},
+				{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0.5f},
+				{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.5f}
+			};
+			descriptorAllocator.init(device, ratios, frameSlotCount * 2);
+		}
+
+		void createDescriptorSets()
+		{
+			descriptorSets.resize(frameSlotCount);
+			boundTextureViews.assign(frameSlotCount, placeholderImageView);
+			descriptorAllocator.allocate(std::vector<VkDescriptorSetLayout>(frameSlotCount, descriptorSetLayout), descriptorSets.data());
+
+			for(size_t i = 0; i < frameSlotCount; i++)
 			{
+				//the dynamic offset picks the block inside the ring, the range covers one block
 				VkDescriptorBufferInfo bufferInfo = {};
-				bufferInfo.buffer = uniformBuffers[i];
+				bufferInfo.buffer = uniformRings[i].buffer;
 				bufferInfo.offset = 0;
 				bufferInfo.range = sizeof(UniformBufferObject);
 
 				VkDescriptorImageInfo imageInfo = {};
 				imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-				imageInfo.imageView = textureImageView;
+				imageInfo.imageView = placeholderImageView;
 				imageInfo.sampler = textureSampler;
 
-				std::array<VkWriteDescriptorSet, 2> descriptorWrites = {};
+				VkDescriptorBufferInfo instanceInfo = {};
+				instanceInfo.buffer = instanceBuffers[i];
+				instanceInfo.offset = 0;
+				instanceInfo.range = VK_WHOLE_SIZE;
+
+				//without culling the vertex shader never reads binding 3, the instance buffer stands in to keep the set complete
+				VkDescriptorBufferInfo visibleInfo = {};
+				visibleInfo.buffer = options.gpuCulling ? visibleInstanceBuffers[i] : instanceBuffers[i];
+				visibleInfo.offset = 0;
+				visibleInfo.range = VK_WHOLE_SIZE;
+
+				std::array<VkWriteDescriptorSet, 4> descriptorWrites = {};
 				
 				descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 				descriptorWrites[0].dstSet = descriptorSets[i];
 				descriptorWrites[0].dstBinding = 0;
 				descriptorWrites[0].dstArrayElement = 0;
-				descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+				descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 				descriptorWrites[0].descriptorCount = 1;
 				descriptorWrites[0].pBufferInfo = &bufferInfo;
 				descriptorWrites[0].pImageInfo = nullptr; //optioanl
@@ -1105,46 +2883,232 @@ class HelloTringleApplication
 				descriptorWrites[1].descriptorCount = 1;
 				descriptorWrites[1].pImageInfo = &imageInfo;
 
+				descriptorWrites[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				descriptorWrites[2].dstSet = descriptorSets[i];
+				descriptorWrites[2].dstBinding = 2;
+				descriptorWrites[2].dstArrayElement = 0;
+				descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+				descriptorWrites[2].descriptorCount = 1;
+				descriptorWrites[2].pBufferInfo = &instanceInfo;
+
+				descriptorWrites[3].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				descriptorWrites[3].dstSet = descriptorSets[i];
+				descriptorWrites[3].dstBinding = 3;
+				descriptorWrites[3].dstArrayElement = 0;
+				descriptorWrites[3].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+				descriptorWrites[3].descriptorCount = 1;
+				descriptorWrites[3].pBufferInfo = &visibleInfo;
+
 				vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
 			}
+
+			if(options.gpuCulling)
+			{
+				createCullDescriptorSets();
+			}
+			if(bindlessSupported)
+			{
+				createTextureTable();
+			}
+		}
+
+		void createCullDescriptorSets()
+		{
+			cullDescriptorSets.resize(frameSlotCount);
+			descriptorAllocator.allocate(std::vector<VkDescriptorSetLayout>(frameSlotCount, cullDescriptorSetLayout), cullDescriptorSets.data());
+
+			for(size_t i = 0; i < frameSlotCount; i++)
+			{
+				std::array<VkDescriptorBufferInfo, 4> bufferInfos = {};
+				bufferInfos[0].buffer = uniformRings[i].buffer;
+				bufferInfos[0].range = sizeof(CullUniforms);
+				bufferInfos[1].buffer = instanceBuffers[i];
+				bufferInfos[1].range = VK_WHOLE_SIZE;
+				bufferInfos[2].buffer = visibleInstanceBuffers[i];
+				bufferInfos[2].range = VK_WHOLE_SIZE;
+				bufferInfos[3].buffer = drawCommandBuffers[i];
+				bufferInfos[3].range = VK_WHOLE_SIZE;
+
+				std::array<VkWriteDescriptorSet, 4> descriptorWrites = {};
+				for(uint32_t binding = 0; binding < descriptorWrites.size(); binding++)
+				{
+					descriptorWrites[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+					descriptorWrites[binding].dstSet = cullDescriptorSets[i];
+					descriptorWrites[binding].dstBinding = binding;
+					descriptorWrites[binding].dstArrayElement = 0;
+					descriptorWrites[binding].descriptorType = binding == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+					descriptorWrites[binding].descriptorCount = 1;
+					descriptorWrites[binding].pBufferInfo = &bufferInfos[binding];
+				}
+
+				vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+			}
+		}
+
+		//update after bind lets the slot change while command buffers using the set are recorded or pending, as long as they do not sample it
+		void writeTextureTableSlot(uint32_t slot, VkImageView view)
+		{
+			VkDescriptorImageInfo imageInfo = {};
+			imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			imageInfo.imageView = view;
+			imageInfo.sampler = textureSampler;
+
+			VkWriteDescriptorSet descriptorWrite = {};
+			descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			descriptorWrite.dstSet = textureTableSet;
+			descriptorWrite.dstBinding = 0;
+			descriptorWrite.dstArrayElement = slot;
+			descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			descriptorWrite.descriptorCount = 1;
+			descriptorWrite.pImageInfo = &imageInfo;
+			vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+		}
+
+		//a small checkerboard sampled until the requested texture is resident
+		void createPlaceholderTexture()
+		{
+			const uint32_t size = 8;
+			std::vector<uint32_t> pixels(size * size);
+			for(uint32_t y = 0; y < size; y++)
+			{
+				for(uint32_t x = 0; x < size; x++)
+				{
+					pixels[y * size + x] = ((x ^ y) & 1) ? 0xff9f9f9fu : 0xff6f6f6fu;
+				}
+			}
+
+			createImage(size, size, 1, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, placeholderImage, placeholderImageAllocation);
+			uploader.uploadImage(placeholderImage, size, size, pixels.data(), pixels.size() * sizeof(uint32_t), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+			placeholderImageView = createImageView(placeholderImage, VK_FORMAT_R8G8B8A8_UNORM, 1);
 		}
 
-		void createTextureImage()
+		//queues the texture on the worker pool, pollTextureLoads uploads it once it is decoded
+		void startTextureLoads()
 		{
-			int texWidth, texHeight, texChannels;
-			stbi_uc* pixles = stbi_load("textures/texture.jpg", &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-			VkDeviceSize imageSize = texWidth * texHeight * 4;
+			TextureDecodeSettings settings;
+			settings.mipMode = options.mipMode;
+
+			//blitting needs linear filtering support for the format as well as blit source and destination support
+			VkFormatProperties formatProperties;
+			vkGetPhysicalDeviceFormatProperties(physicalDevice, VK_FORMAT_R8G8B8A8_UNORM, &formatProperties);
+			VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+			settings.canBlitRGBA8 = (formatProperties.optimalTilingFeatures & blitFeatures) == blitFeatures;
+
+			//the values in KTX2 files are VkFormat values
+			VkPhysicalDevice queriedDevice = physicalDevice;
+			settings.formatSupported = [queriedDevice](uint32_t format)
+			{
+				VkFormatProperties properties;
+				vkGetPhysicalDeviceFormatProperties(queriedDevice, static_cast<VkFormat>(format), &properties);
+				VkFormatFeatureFlags sampleFeatures = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+				return (properties.optimalTilingFeatures & sampleFeatures) == sampleFeatures;
+			};
 
-			if(!pixles)
+			if(bindlessSupported && options.texturePaths.size() >= textureTableSize)
 			{
-				throw std::runtime_error("failed to load texture image!");
+				throw std::runtime_error("more textures than the bindless texture table holds!");
 			}
 
-			VkBuffer stagingBuffer;
-			VkDeviceMemory stagingBufferMemory;
-			createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+			textureDecoder.init(&workers, std::move(settings));
+			textures.resize(options.texturePaths.size());
+			for(const std::string& path : options.texturePaths)
+			{
+				textureDecoder.request(path);
+			}
+		}
 
-			void* data;
-			vkMapMemory(device, stagingBufferMemory, 0, imageSize, 0, &data);
-			memcpy(data, pixles, static_cast<size_t>(imageSize));
-			vkUnmapMemory(device, stagingBufferMemory);
+		//hands every texture decoded since the last call to the upload engine, on the main thread as the engine is not thread safe
+		void pollTextureLoads()
+		{
+			std::vector<std::unique_ptr<DecodedTexture>> decoded;
+			textureDecoder.collect(decoded);
+			if(decoded.empty())
+			{
+				return;
+			}
 
-			stbi_image_free(pixles);
+			for(auto& texture : decoded)
+			{
+				uploadDecodedTexture(*texture);
+			}
+			uploader.flush();
+		}
 
-			createImage(texWidth, texHeight, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory);
+		void uploadDecodedTexture(const DecodedTexture& texture)
+		{
+			if(!texture.error.empty())
+			{
+				throw std::runtime_error(texture.error);
+			}
+
+			uint32_t textureId = texture.id;
+			LoadedTexture& loaded = textures[textureId];
+			loaded.mipLevels = texture.generateMips ? mipLevelCount(texture.width, texture.height) : static_cast<uint32_t>(texture.levels.size());
+			VkFormat textureFormat = static_cast<VkFormat>(texture.format);
+			VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | (texture.generateMips ? VK_IMAGE_USAGE_TRANSFER_SRC_BIT : 0);
+			createImage(texture.width, texture.height, loaded.mipLevels, VK_SAMPLE_COUNT_1_BIT, textureFormat, VK_IMAGE_TILING_OPTIMAL, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, loaded.image, loaded.allocation);
 			//createImage(texWidth, texHeight, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory);
 
-			transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-			copyBufferToImage(stagingBuffer, textureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
-			transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+			//the levels are copied into staging memory during the call so the decoded data can be dropped right after
+			if(texture.generateMips)
+			{
+				VkDeviceSize imageSize = static_cast<VkDeviceSize>(texture.width) * texture.height * 4;
+				uploader.uploadImageGenerateMips(loaded.image, texture.width, texture.height, loaded.mipLevels, texture.levels[0], imageSize, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+			}
+			else
+			{
+				uploader.uploadImageLevels(loaded.image, texture.width, texture.height, texture.info.blockDim, texture.info.blockSize, texture.levels, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+			}
+			loaded.view = createImageView(loaded.image, textureFormat, loaded.mipLevels);
+
+			//once the copies have completed the texture gets its table slot, or is picked up by bindResidentTexture without bindless textures
+			uploader.onComplete([this, textureId]()
+			{
+				textures[textureId].resident = true;
+				if(bindlessSupported)
+				{
+					writeTextureTableSlot(textureId + 1, textures[textureId].view);
+					//rewrites the instances so they switch from the placeholder to the new slot
+					sceneVersion++;
+				}
+			});
 
-			vkDestroyBuffer(device, stagingBuffer, nullptr);
-			vkFreeMemory(device, stagingBufferMemory, nullptr);
+			if(debug_log) std::cout << "> Loaded texture " << texture.path << " " << texture.width << "x" << texture.height << " with " << loaded.mipLevels << " mip levels" << (texture.generateMips ? " blitted on the gpu" : (texture.decodedOnCpu ? " built on the cpu" : "")) << "\n";
 		}
 
-		void createTextureImageView()
+		//without bindless textures points this frame's descriptor set at the first texture once it is resident
+		//the slot wait in drawFrame makes the update safe
+		void bindResidentTexture()
 		{
-			textureImageView = createImageView(textureImage, VK_FORMAT_R8G8B8A8_UNORM);
+			if(bindlessSupported)
+			{
+				return;
+			}
+
+			VkImageView view = textures[0].resident ? textures[0].view : placeholderImageView;
+			if(boundTextureViews[currentFrame] == view)
+			{
+				return;
+			}
+
+			VkDescriptorImageInfo imageInfo = {};
+			imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			imageInfo.imageView = view;
+			imageInfo.sampler = textureSampler;
+
+			VkWriteDescriptorSet descriptorWrite = {};
+			descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			descriptorWrite.dstSet = descriptorSets[currentFrame];
+			descriptorWrite.dstBinding = 1;
+			descriptorWrite.dstArrayElement = 0;
+			descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			descriptorWrite.descriptorCount = 1;
+			descriptorWrite.pImageInfo = &imageInfo;
+			vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+
+			//the recorded scene draws bound the set before the update
+			boundTextureViews[currentFrame] = view;
+			recordedDraws[currentFrame].valid = false;
 		}
 
 		void createTextureSampler()
@@ -1169,7 +3133,8 @@ class HelloTringleApplication
 			samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
 			samplerInfo.mipLodBias = 0.0f;
 			samplerInfo.minLod = 0.0f;
-			samplerInfo.maxLod = 0.0f;
+			//the sampler is created before the texture is loaded, the image view limits the levels
+			samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
 
 			if(vkCreateSampler(device, &samplerInfo, nullptr, &textureSampler) != VK_SUCCESS)
 			{
@@ -1179,27 +3144,80 @@ class HelloTringleApplication
 
 		void drawFrame()
 		{
-			vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+			profiler.beginFrame(frameNumber, static_cast<uint32_t>(currentFrame));
+
+			double zoneStart = profiler.now();
+			frameScheduler.waitForSlot(frameNumber);
+			profiler.addCpuZone("frame wait", zoneStart, profiler.now());
+			latencyTracker.collect([this](uint64_t frame) { return frameScheduler.isFrameComplete(frame); });
+
+			profiler.resolveGpuZones(static_cast<uint32_t>(currentFrame));
+			resolvePipelineStatistics(currentFrame);
+			destroyRetiredSwapChains(false);
+
+			zoneStart = profiler.now();
+			uploader.collect();
+			pollTextureLoads();
+			writeReadback(currentFrame);
+			profiler.addCpuZone("collect", zoneStart, profiler.now());
 			
+			if(requestedPresentProfile != presentProfile)
+			{
+				applyPresentProfile(requestedPresentProfile);
+			}
+
 			uint32_t imageIndex;
-			VkResult result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
-			if(result == VK_ERROR_OUT_OF_DATE_KHR)
+			if(options.headless)
 			{
-				recreateSwapChain();
-				return;
+				//offscreen targets are used round robin, imageFrames below still guards their reuse
+				imageIndex = static_cast<uint32_t>(frameNumber % swapChainImages.size());
+			}
+			else
+			{
+				zoneStart = profiler.now();
+				VkResult result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+				profiler.addCpuZone("acquire", zoneStart, profiler.now());
+				if(result == VK_ERROR_OUT_OF_DATE_KHR)
+				{
+					//nothing was submitted for this frame yet
+					recreateSwapChain(frameNumber);
+					return;
+				}
+				else if(result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+				{
+					throw std::runtime_error("failed to acquire swap chain image!");
+				}
 			}
-			else if(result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+
+			//only blocks when there are fewer images than frames in flight, otherwise the slot wait already covered the image's last frame
+			if(imageFrames[imageIndex] != NO_FRAME && !frameScheduler.isFrameComplete(imageFrames[imageIndex]))
 			{
-				throw std::runtime_error("failed to acquire swap chain image!");
+				zoneStart = profiler.now();
+				frameScheduler.waitForFrame(imageFrames[imageIndex]);
+				profiler.addCpuZone("image wait", zoneStart, profiler.now());
 			}
+			imageFrames[imageIndex] = frameNumber;
+
+			//the slot wait above guarantees the gpu is done with this frame's ring and command buffer
+			zoneStart = profiler.now();
+			uniformRings[currentFrame].reset();
+			updateUniformBuffers();
+			bindResidentTexture();
+			profiler.addCpuZone("ubo update", zoneStart, profiler.now());
 
-			if(imagesInFlight[imageIndex] != VK_NULL_HANDLE)
+			auto recordStartTime = std::chrono::high_resolution_clock::now();
+			zoneStart = profiler.now();
+
+			if(!recordSceneCommandBuffers())
 			{
-				vkWaitForFences(device, 1, &imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
+				reusedFrameCount++;
 			}
-			imagesInFlight[imageIndex] = inFlightFences[currentFrame];
+			vkResetCommandPool(device, commandPools[currentFrame], 0);
+			recordCommandBuffer(commandBuffers[currentFrame], imageIndex);
 
-			updateUniformBuffers(imageIndex);
+			recordTimeTotal += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - recordStartTime).count();
+			recordedFrameCount++;
+			profiler.addCpuZone("record", zoneStart, profiler.now());
 			
 			VkSubmitInfo submitInfo = {};
 			submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
@@ -1207,28 +3225,46 @@ class HelloTringleApplication
 			VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
 			VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
 			
-			submitInfo.waitSemaphoreCount = 1;
+			//nothing is acquired or presented headless
+			submitInfo.waitSemaphoreCount = options.headless ? 0 : 1;
 			submitInfo.pWaitSemaphores = waitSemaphores;
 			submitInfo.pWaitDstStageMask = waitStages;
 			submitInfo.commandBufferCount = 1;
-			submitInfo.pCommandBuffers = &commandBuffers[imageIndex];
+			submitInfo.pCommandBuffers = &commandBuffers[currentFrame];
 			
-			VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame]};
+			//the value of the binary render finished semaphore is ignored
+			VkSemaphore signalSemaphores[] = {frameScheduler.getSemaphore(), renderFinishedSemaphores[currentFrame]};
+			uint64_t signalValues[] = {frameScheduler.getSignalValue(frameNumber), 0};
 
-			submitInfo.signalSemaphoreCount = 1;
+			submitInfo.signalSemaphoreCount = options.headless ? 1 : 2;
 			submitInfo.pSignalSemaphores = signalSemaphores;
 
-			vkResetFences(device, 1, &inFlightFences[currentFrame]);
+			VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+			timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+			timelineInfo.signalSemaphoreValueCount = submitInfo.signalSemaphoreCount;
+			timelineInfo.pSignalSemaphoreValues = signalValues;
+			submitInfo.pNext = &timelineInfo;
 			
-			if(vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS)
+			latencyTracker.beginFrame(frameNumber, presentProfile, inputSampleTime);
+			zoneStart = profiler.now();
+			if(vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
 			{
 				throw std::runtime_error("failed to submit draw command buffer!");
 			}
+			profiler.addCpuZone("submit", zoneStart, profiler.now());
+
+			if(options.headless)
+			{
+				profiler.endFrame();
+				currentFrame = (currentFrame + 1) % frameSlotCount;
+				frameNumber++;
+				return;
+			}
 
 			VkPresentInfoKHR presentInfo = {};
 			presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 			presentInfo.waitSemaphoreCount = 1;
-			presentInfo.pWaitSemaphores = signalSemaphores;
+			presentInfo.pWaitSemaphores = &renderFinishedSemaphores[currentFrame];
 
 			VkSwapchainKHR swapChains[] = {swapChain};
 
@@ -1237,29 +3273,34 @@ class HelloTringleApplication
 			presentInfo.pImageIndices = &imageIndex;
 			presentInfo.pResults = nullptr; //optional
 
-			result = vkQueuePresentKHR(presentQueue, &presentInfo);
+			zoneStart = profiler.now();
+			VkResult result = vkQueuePresentKHR(presentQueue, &presentInfo);
+			profiler.addCpuZone("present", zoneStart, profiler.now());
 			if(result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized)
 			{
 				framebufferResized = false;
-				recreateSwapChain();
+				//this frame was already submitted and still renders into the old framebuffer
+				recreateSwapChain(frameNumber + 1);
 			}
 			else if(result != VK_SUCCESS)
 			{
 				throw std::runtime_error("failed to present swap chain image!");
 			}
-			currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+			profiler.endFrame();
+			currentFrame = (currentFrame + 1) % frameSlotCount;
+			frameNumber++;
 		}
 
-		VkImageView createImageView(VkImage image, VkFormat format)
+		VkImageView createImageView(VkImage image, VkFormat format, uint32_t mipLevels, VkImageAspectFlags aspectFlags = VK_IMAGE_ASPECT_COLOR_BIT)
 		{
 			VkImageViewCreateInfo viewInfo = {};
 			viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
 			viewInfo.image = image;
 			viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
 			viewInfo.format = format;
-			viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			viewInfo.subresourceRange.aspectMask = aspectFlags;
 			viewInfo.subresourceRange.baseMipLevel = 0;
-			viewInfo.subresourceRange.levelCount = 1;
+			viewInfo.subresourceRange.levelCount = mipLevels;
 			viewInfo.subresourceRange.baseArrayLayer = 0;
 			viewInfo.subresourceRange.layerCount = 1;
 
@@ -1271,108 +3312,7 @@ class HelloTringleApplication
 			return imageView;
 		}
 
-		void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout)
-		{
-			VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
-			VkImageMemoryBarrier barrier = {};
-			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-			barrier.oldLayout = oldLayout;
-			barrier.newLayout = newLayout;
-			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-			barrier.image = image;
-			barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			barrier.subresourceRange.baseMipLevel = 0;
-			barrier.subresourceRange.levelCount = 1;
-			barrier.subresourceRange.baseArrayLayer = 0;
-			barrier.subresourceRange.layerCount = 1;
-
-			VkPipelineStageFlags sourceStage;
-			VkPipelineStageFlags destinationStage;
-
-			if(oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
-			{
-				barrier.srcAccessMask = 0;
-				barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-				sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-				destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-			}
-			else if(oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
-			{
-				barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-				barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-				sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-				destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-			}
-			else
-			{
-				throw std::runtime_error("unsupported layout transition!");
-			}
-
-			vkCmdPipelineBarrier(commandBuffer, sourceStage, destinationStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
-
-			endSingleTimeCommands(commandBuffer);
-		}
-
-		void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height)
-		{
-			VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
-			VkBufferImageCopy region = {};
-			region.bufferOffset = 0;
-			region.bufferRowLength = 0;
-			region.bufferImageHeight = 0;
-			region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			region.imageSubresource.mipLevel = 0;
-			region.imageSubresource.baseArrayLayer = 0;
-			region.imageSubresource.layerCount = 1;
-			region.imageOffset = {0, 0, 0};
-			region.imageExtent = {width, height, 1};
-
-			vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-
-			endSingleTimeCommands(commandBuffer);
-		}
-
-		VkCommandBuffer beginSingleTimeCommands()
-		{
-			VkCommandBufferAllocateInfo allocInfo = {};
-			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-			allocInfo.commandPool = commandPool;
-			allocInfo.commandBufferCount = 1;
-
-			VkCommandBuffer commandBuffer;
-			vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer);
-
-			VkCommandBufferBeginInfo beginInfo = {};
-			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-			beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-			vkBeginCommandBuffer(commandBuffer, &beginInfo);
-
-			return commandBuffer;
-		}
-
-		void endSingleTimeCommands(VkCommandBuffer commandBuffer)
-		{
-			vkEndCommandBuffer(commandBuffer);
-
-			VkSubmitInfo submitInfo = {};
-			submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-			submitInfo.commandBufferCount = 1;
-			submitInfo.pCommandBuffers = &commandBuffer;
-
-			vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-			vkQueueWaitIdle(graphicsQueue);
-
-			vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
-		}
-
-		void createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory)
+		void createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkSampleCountFlagBits numSamples, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, Allocation& imageAllocation)
 		{
 			VkImageCreateInfo imageInfo = {};
 			imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -1380,13 +3320,13 @@ class HelloTringleApplication
 			imageInfo.extent.width = width;
 			imageInfo.extent.height = height;
 			imageInfo.extent.depth = 1;
-			imageInfo.mipLevels = 1;
+			imageInfo.mipLevels = mipLevels;
 			imageInfo.arrayLayers = 1;
 			imageInfo.format = format;
 			imageInfo.tiling = tiling;
 			imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 			imageInfo.usage = usage;
-			imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+			imageInfo.samples = numSamples;
 			imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 			imageInfo.flags = 0; //optional
 
@@ -1396,41 +3336,104 @@ class HelloTringleApplication
 			}
 
 			VkMemoryRequirements memRequirements;
-			vkGetImageMemoryRequirements(device, textureImage, &memRequirements);
+			vkGetImageMemoryRequirements(device, image, &memRequirements);
 
-			VkMemoryAllocateInfo allocInfo = {};
-			allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-			allocInfo.allocationSize = memRequirements.size;
-			allocInfo.memoryTypeIndex = findMemeoryType(memRequirements.memoryTypeBits, properties);
-
-			if(vkAllocateMemory(device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS)
+			//lazily allocated memory only exists on tiled gpus, elsewhere transient attachments live in ordinary device local memory
+			if((properties & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) && !allocator.hasMemoryType(memRequirements.memoryTypeBits, properties))
 			{
-				throw std::runtime_error("failed to allocate image memory!");
+				properties &= ~VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
 			}
 
-			vkBindImageMemory(device, image, imageMemory, 0);
+			imageAllocation = allocator.allocate(memRequirements, findMemeoryType(memRequirements.memoryTypeBits, properties), tiling == VK_IMAGE_TILING_LINEAR);
+
+			vkBindImageMemory(device, image, imageAllocation.memory, imageAllocation.offset);
 		}
 
-		void updateUniformBuffers(uint32_t currentImage)
+		//writes the per frame constants into the current frame's ring, the instances only when the scene changed
+		void updateUniformBuffers()
 		{
 			static auto startTime = std::chrono::high_resolution_clock::now();
 
 			auto currentTime = std::chrono::high_resolution_clock::now();
 			float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
 
+			//every instance spins the same way, the vertex shader applies it after the mesh transform
 			UniformBufferObject ubo = {};
-			ubo.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-			ubo.view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-			ubo.proj = glm::perspective(glm::radians(45.0f), swapChainExtent.width / (float) swapChainExtent.height, 0.1f, 10.0f);
+			ubo.spin = time * glm::radians(90.0f);
+			ubo.view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f) * cameraDistance, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+			ubo.proj = glm::perspective(glm::radians(45.0f), swapChainExtent.width / (float) swapChainExtent.height, 0.1f, 10.0f * cameraDistance);
 			ubo.proj[1][1] *= -1;
+			cameraUniformOffset = uniformRings[currentFrame].push(&ubo, sizeof(ubo));
+
+			if(options.gpuCulling)
+			{
+				pushCullUniforms(ubo);
+			}
+
+			if(instanceVersions[currentFrame] == sceneVersion)
+			{
+				return;
+			}
+			instanceVersions[currentFrame] = sceneVersion;
+
+			InstanceData* instances = static_cast<InstanceData*>(instanceAllocations[currentFrame].mapped);
+			uint32_t objectCount = static_cast<uint32_t>(sceneObjects.size());
+			auto writeInstances = [&](uint32_t first, uint32_t end)
+			{
+				for(uint32_t i = first; i < end; i++)
+				{
+					InstanceData instance;
+					instance.model = glm::translate(glm::mat4(1.0f), sceneObjects[i].position);
+					instance.tint = sceneObjects[i].tint;
+					instance.textureIndex = textures[sceneObjects[i].texture].resident ? sceneObjects[i].texture + 1 : 0;
+					instances[i] = instance;
+				}
+			};
+
+			if(objectCount <= INSTANCE_UPDATE_BATCH)
+			{
+				writeInstances(0, objectCount);
+			}
+			else
+			{
+				uint32_t batchCount = (objectCount + INSTANCE_UPDATE_BATCH - 1) / INSTANCE_UPDATE_BATCH;
+				workers.parallelFor(batchCount, [&](uint32_t batch, uint32_t)
+				{
+					writeInstances(batch * INSTANCE_UPDATE_BATCH, std::min(objectCount, (batch + 1) * INSTANCE_UPDATE_BATCH));
+				});
+			}
+		}
+
+		void pushCullUniforms(const UniformBufferObject& ubo)
+		{
+			CullUniforms cull = {};
+
+			//gribb and hartmann plane extraction from the rows of the view projection matrix, normals point inwards
+			glm::mat4 viewProj = ubo.proj * ubo.view;
+			glm::vec4 rows[4];
+			for(int row = 0; row < 4; row++)
+			{
+				rows[row] = glm::vec4(viewProj[0][row], viewProj[1][row], viewProj[2][row], viewProj[3][row]);
+			}
+			for(int axis = 0; axis < 3; axis++)
+			{
+				cull.frustumPlanes[axis * 2] = rows[3] + rows[axis];
+				cull.frustumPlanes[axis * 2 + 1] = rows[3] - rows[axis];
+			}
+			//clip space depth runs from 0 rather than -w
+			cull.frustumPlanes[4] = rows[2];
+			for(glm::vec4& plane : cull.frustumPlanes)
+			{
+				plane /= glm::length(glm::vec3(plane));
+			}
 
-			void* data;
-			vkMapMemory(device, uniformBufferMemory[currentImage], 0, sizeof(ubo), 0, &data);
-			memcpy(data, &ubo, sizeof(ubo));
-			vkUnmapMemory(device, uniformBufferMemory[currentImage]);
+			//the spin rotates about the centred mesh's origin so it moves neither the sphere nor its radius
+			cull.boundingSphere = glm::vec4(glm::vec3(meshTransform * glm::vec4(meshCenter, 1.0f)), meshRadius * meshScale);
+			cull.instanceCount = static_cast<uint32_t>(sceneObjects.size());
+			cullUniformOffset = uniformRings[currentFrame].push(&cull, sizeof(cull));
 		}
 
-		void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory)
+		void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, Allocation& bufferAllocation)
 		{
 			VkBufferCreateInfo bufferInfo = {};
 			bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -1446,17 +3449,9 @@ class HelloTringleApplication
 			VkMemoryRequirements memRequirements;
 			vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
 
-			VkMemoryAllocateInfo allocInfo = {};
-			allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-			allocInfo.allocationSize = memRequirements.size;
-			allocInfo.memoryTypeIndex = findMemeoryType(memRequirements.memoryTypeBits, properties);
+			bufferAllocation = allocator.allocate(memRequirements, findMemeoryType(memRequirements.memoryTypeBits, properties), true);
 
-			if(vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS)
-			{
-				throw std::runtime_error("failed to allocate vertex buffer memory!");
-			}
-
-			vkBindBufferMemory(device, buffer, bufferMemory, 0);
+			vkBindBufferMemory(device, buffer, bufferAllocation.memory, bufferAllocation.offset);
 		}
 
 		uint32_t findMemeoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
@@ -1475,20 +3470,6 @@ class HelloTringleApplication
 			throw std::runtime_error("failed to find suitable memory type!");
 		}
 
-		void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
-		{
-			VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
-			VkBufferCopy copyRegion = {};
-			copyRegion.srcOffset = 0; //optional
-			copyRegion.dstOffset = 0; //optional
-			copyRegion.size = size;
-
-			vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
-			
-			endSingleTimeCommands(commandBuffer);
-		}
-
 		VkShaderModule createShaderModule(const std::vector<char>& code)
 		{
 			VkShaderModuleCreateInfo createInfo = {};
@@ -1521,20 +3502,40 @@ class HelloTringleApplication
 			return availableFormats[0];
 		}
 
+		//the present profile's first supported mode
 		VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes)
 		{
-			for(const auto& availablePresentMode : availablePresentModes)
+			for(VkPresentModeKHR presentMode : getPresentProfileSettings(presentProfile).presentModes)
 			{
-				if(availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR)
+				if(std::find(availablePresentModes.begin(), availablePresentModes.end(), presentMode) != availablePresentModes.end())
 				{
-					if(debug_log) std::cout << ">> found optimal swap present mode\n";
-					return availablePresentMode;
+					if(debug_log) std::cout << ">> swap present mode = " << presentMode << "\n";
+					return presentMode;
 				}
 			}
 
 			return VK_PRESENT_MODE_FIFO_KHR;
 		}
 
+		uint32_t getProfileFramesInFlight(PresentProfile profile)
+		{
+			uint32_t framesInFlight = getPresentProfileSettings(profile).framesInFlight;
+			return framesInFlight > 0 ? framesInFlight : options.framesInFlight;
+		}
+
+		//the present mode and image count need a new swapchain, the frames in flight and limiter apply from the next frame
+		void applyPresentProfile(PresentProfile profile)
+		{
+			presentProfile = profile;
+			frameScheduler.setFramesInFlight(std::min(getProfileFramesInFlight(profile), frameSlotCount));
+			frameLimiter.setLimit(getPresentProfileSettings(profile).frameLimit);
+			if(!options.headless)
+			{
+				recreateSwapChain(frameNumber);
+			}
+			if(stats_log) std::cout << "present profile " << getPresentProfileSettings(profile).name << ", " << frameScheduler.getFramesInFlight() << " frames in flight\n";
+		}
+
 		VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities)
 		{
 			if(capabilities.currentExtent.width != UINT32_MAX)
@@ -1550,7 +3551,7 @@ class HelloTringleApplication
 				VkExtent2D actualExtent = {static_cast<uint32_t>(width), static_cast<uint32_t>(height)};
 
 				actualExtent.width = std::max(capabilities.minImageExtent.width, std::min(capabilities.maxImageExtent.width, actualExtent.width));
-				actualExtent.height = std::max(capabilities.minImageExtent.height, std::min(capabilities.maxImageExtent.height, actualExtent.width));
+				actualExtent.height = std::max(capabilities.minImageExtent.height, std::min(capabilities.maxImageExtent.height, actualExtent.height));
 
 				if(debug_log) std::cout << ">> swap extent = (" << actualExtent.width << ", " << actualExtent.height << ")\n";
 				return actualExtent;
@@ -1582,6 +3583,23 @@ class HelloTringleApplication
 			return details;
 		}
 
+		//highest count up to requested that both colour and depth framebuffer attachments support, 1 is always supported
+		VkSampleCountFlagBits getMaxUsableSampleCount(uint32_t requested)
+		{
+			VkPhysicalDeviceProperties deviceProperties;
+			vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+			VkSampleCountFlags counts = deviceProperties.limits.framebufferColorSampleCounts & deviceProperties.limits.framebufferDepthSampleCounts;
+			for(uint32_t samples = VK_SAMPLE_COUNT_64_BIT; samples > VK_SAMPLE_COUNT_1_BIT; samples >>= 1)
+			{
+				if(samples <= requested && (counts & samples))
+				{
+					return static_cast<VkSampleCountFlagBits>(samples);
+				}
+			}
+			return VK_SAMPLE_COUNT_1_BIT;
+		}
+
 		bool isDeviceSuitable(VkPhysicalDevice device)
 		{
 			QueueFamilyIndicies indicies = findQueueFamilies(device);
@@ -1589,13 +3607,38 @@ class HelloTringleApplication
 			bool extensionsSupported = checkDeviceExtensionSupport(device);
 
 			bool swapChainAdequate = false;
-			if(extensionsSupported)
+			if(options.headless)
+			{
+				swapChainAdequate = true;
+			}
+			else if(extensionsSupported)
 			{
 				SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
 				swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
 			}
 
-			return indicies.isComplete() && extensionsSupported && swapChainAdequate;
+			//frame pacing waits on a timeline semaphore
+			bool timelineSupported = getVulkan12Features(device).timelineSemaphore;
+
+			return indicies.isComplete() && extensionsSupported && swapChainAdequate && timelineSupported;
+		}
+
+		//all false on devices older than vulkan 1.2
+		VkPhysicalDeviceVulkan12Features getVulkan12Features(VkPhysicalDevice device)
+		{
+			VkPhysicalDeviceVulkan12Features features12 = {};
+			features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+			VkPhysicalDeviceProperties deviceProperties;
+			vkGetPhysicalDeviceProperties(device, &deviceProperties);
+			if(deviceProperties.apiVersion >= VK_API_VERSION_1_2)
+			{
+				VkPhysicalDeviceFeatures2 features2 = {};
+				features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+				features2.pNext = &features12;
+				vkGetPhysicalDeviceFeatures2(device, &features2);
+			}
+			return features12;
 		}
 
 		int rateDeviceSuitability(VkPhysicalDevice device)
@@ -1638,6 +3681,23 @@ class HelloTringleApplication
 			return score;
 		}
 
+		bool isDeviceExtensionSupported(VkPhysicalDevice device, const char* extensionName)
+		{
+			uint32_t extensionCount;
+			vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+			std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+			vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+			for(const auto& extension : availableExtensions)
+			{
+				if(std::strcmp(extension.extensionName, extensionName) == 0)
+				{
+					return true;
+				}
+			}
+			return false;
+		}
+
 		bool checkDeviceExtensionSupport(VkPhysicalDevice device)
 		{
 			uint32_t extensionCount;
@@ -1645,7 +3705,8 @@ class HelloTringleApplication
 			std::vector<VkExtensionProperties> availableExtensions(extensionCount);
 			vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
 			
-			std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
+			std::vector<const char*> deviceRequiredExtensions = getRequiredDeviceExtensions();
+			std::set<std::string> requiredExtensions(deviceRequiredExtensions.begin(), deviceRequiredExtensions.end());
 
 			for(const auto& extension : availableExtensions)
 			{
@@ -1658,6 +3719,7 @@ class HelloTringleApplication
 		QueueFamilyIndicies findQueueFamilies(VkPhysicalDevice device)
 		{
 			QueueFamilyIndicies indices;
+			indices.presentRequired = !options.headless;
 
 			uint32_t queueFamilyCount = 0;
 			vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
@@ -1674,7 +3736,10 @@ class HelloTringleApplication
 				}
 				
 				VkBool32 presentSupport = false;
-				vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+				if(!options.headless)
+				{
+					vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+				}
 				
 				if(presentSupport)
 				{
@@ -1688,16 +3753,41 @@ class HelloTringleApplication
 
 				i++;
 			}
+
+			for(uint32_t j = 0; j < queueFamilyCount; j++)
+			{
+				if((queueFamilies[j].queueFlags & VK_QUEUE_TRANSFER_BIT) && !(queueFamilies[j].queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+				{
+					indices.transferFamily = j;
+					break;
+				}
+			}
 			return indices;
 		}
 
+		//the swapchain extension is only needed when presenting
+		std::vector<const char*> getRequiredDeviceExtensions()
+		{
+			if(options.headless)
+			{
+				return {};
+			}
+			return deviceExtensions;
+		}
+
 		std::vector<const char*> getRequiredExtentions()
 		{
-			uint32_t glfwExtensionCount = 0;
-			const char** glfwExtensions;
-			glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+			std::vector<const char*> extensions;
+
+			//headless needs no surface extensions
+			if(!options.headless)
+			{
+				uint32_t glfwExtensionCount = 0;
+				const char** glfwExtensions;
+				glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 
-			std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+				extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+			}
 
 			if(enableValidationLayers)
 			{
@@ -1798,6 +3888,185 @@ class HelloTringleApplication
 		}
 };
 
+//--headless                 render offscreen without a window, display or swapchain
+//--frames <n>               exit after n frames
+//--seconds <s>              exit after rendering for s seconds
+//--frames-in-flight <n>     frames recorded ahead of the gpu with the default present profile, 1 to 4, default 2
+//--present-profile <name>   default, low-latency, throughput or power-saving, keys 1 to 4 switch between them live
+//--mesh <file>              draw a mesh converted with meshconv instead of the built in quad
+//--instances <n>            draw n copies of the mesh on a grid, all in one instanced draw per submesh
+//--gpu-culling              frustum cull the instances in a compute pass and draw them indirectly
+//--depth-prepass            write depth in a subpass of its own before shading so hidden fragments are never shaded
+//--pipeline-stats           count fragment shader invocations to measure overdraw, printed with the stats
+//--vertex-format <name>     float (default) interleaved 32 byte vertices, split puts positions in a stream of their own,
+//                           packed also quantizes to 16 bytes (snorm16 positions, unorm8 colours, half float uvs)
+//--msaa <n>                 samples per pixel, 1 (default) to 64, lowered to the highest count the device supports
+//--texture <file>           texture drawn on the mesh, default textures/texture.jpg, .ktx2 files from texconv skip decoding
+//                           repeat to give the instances different textures
+//--no-bindless              bind the first texture directly instead of through the descriptor indexed texture table
+//--mips <mode>              gpu (default) blits the mip chain, cpu box filters it, off samples mip 0 only
+//--readback <prefix>        headless only, write frames to <prefix>_<frame>.ppm
+//--readback-every <n>       only read back every n-th frame
+//--profile-out <file>       write the recent frame profile history on exit
+//--profile-format <format>  csv, json (default) or chrome trace events
+//--bench-out <file>         write frame time percentiles, fps and startup step times as json
+//--baseline <file>          compare the benchmark against an earlier --bench-out file, fails on a regression
+//--bench-threshold <pct>    how much worse than the baseline counts as a regression, default 10
+//--bench-warmup <n>         frames left out of the frame time percentiles, default 10
+ApplicationOptions parseOptions(int argc, char* argv[])
+{
+	ApplicationOptions options;
+
+	for(int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		auto value = [&]() -> std::string
+		{
+			if(i + 1 >= argc)
+			{
+				throw std::runtime_error("missing value for " + arg);
+			}
+			return argv[++i];
+		};
+
+		if(arg == "--headless")
+		{
+			options.headless = true;
+		}
+		else if(arg == "--frames")
+		{
+			options.frameCount = std::stoull(value());
+		}
+		else if(arg == "--seconds")
+		{
+			options.durationSeconds = std::stod(value());
+		}
+		else if(arg == "--mesh")
+		{
+			options.meshPath = value();
+		}
+		else if(arg == "--frames-in-flight")
+		{
+			options.framesInFlight = static_cast<uint32_t>(std::stoul(value()));
+			if(options.framesInFlight < 1 || options.framesInFlight > MAX_FRAMES_IN_FLIGHT)
+			{
+				throw std::runtime_error("--frames-in-flight must be between 1 and " + std::to_string(MAX_FRAMES_IN_FLIGHT));
+			}
+		}
+		else if(arg == "--present-profile")
+		{
+			std::string name = value();
+			if(!parsePresentProfile(name, options.presentProfile))
+			{
+				throw std::runtime_error("unknown present profile " + name);
+			}
+		}
+		else if(arg == "--instances")
+		{
+			options.instanceCount = static_cast<uint32_t>(std::stoul(value()));
+		}
+		else if(arg == "--depth-prepass")
+		{
+			options.depthPrepass = true;
+		}
+		else if(arg == "--vertex-format")
+		{
+			std::string name = value();
+			if(!parseVertexLayout(name, options.vertexLayout))
+			{
+				throw std::runtime_error("unknown vertex format " + name);
+			}
+		}
+		else if(arg == "--msaa")
+		{
+			options.msaaSamples = static_cast<uint32_t>(std::stoul(value()));
+			if(options.msaaSamples < 1 || options.msaaSamples > 64 || (options.msaaSamples & (options.msaaSamples - 1)) != 0)
+			{
+				throw std::runtime_error("--msaa must be a power of two between 1 and 64");
+			}
+		}
+		else if(arg == "--pipeline-stats")
+		{
+			options.pipelineStatistics = true;
+		}
+		else if(arg == "--gpu-culling")
+		{
+			options.gpuCulling = true;
+		}
+		else if(arg == "--texture")
+		{
+			options.texturePaths.push_back(value());
+		}
+		else if(arg == "--no-bindless")
+		{
+			options.bindless = false;
+		}
+		else if(arg == "--mips")
+		{
+			options.mipMode = value();
+			if(options.mipMode != "gpu" && options.mipMode != "cpu" && options.mipMode != "off")
+			{
+				throw std::runtime_error("unknown mip mode " + options.mipMode);
+			}
+		}
+		else if(arg == "--readback")
+		{
+			options.readbackPath = value();
+		}
+		else if(arg == "--readback-every")
+		{
+			options.readbackInterval = std::max(1ul, std::stoul(value()));
+		}
+		else if(arg == "--profile-out")
+		{
+			options.profileOutPath = value();
+		}
+		else if(arg == "--profile-format")
+		{
+			options.profileFormat = value();
+			if(options.profileFormat != "csv" && options.profileFormat != "json" && options.profileFormat != "chrome")
+			{
+				throw std::runtime_error("unknown profile format " + options.profileFormat);
+			}
+		}
+		else if(arg == "--bench-out")
+		{
+			options.benchOutPath = value();
+		}
+		else if(arg == "--baseline")
+		{
+			options.benchBaselinePath = value();
+		}
+		else if(arg == "--bench-threshold")
+		{
+			options.benchThreshold = std::stod(value()) / 100.0;
+		}
+		else if(arg == "--bench-warmup")
+		{
+			options.benchWarmupFrames = std::stoull(value());
+		}
+		else
+		{
+			throw std::runtime_error("unknown option " + arg);
+		}
+	}
+
+	if(!options.readbackPath.empty() && !options.headless)
+	{
+		throw std::runtime_error("--readback requires --headless");
+	}
+	if(!options.benchBaselinePath.empty() && options.benchOutPath.empty())
+	{
+		throw std::runtime_error("--baseline requires --bench-out");
+	}
+	if(options.texturePaths.empty())
+	{
+		options.texturePaths.push_back("textures/texture.jpg");
+	}
+
+	return options;
+}
+
 int main(int argc, char* argv[])
 {
 	#if (DEBUG)
@@ -1809,7 +4078,7 @@ int main(int argc, char* argv[])
 	try
 	{
 		{
-			app.run();
+			app.run(parseOptions(argc, argv));
 		}
 	}
 	catch(const std::exception& e)
@@ -0,0 +1,421 @@
+#pragma once
+
+#include "pch.h"
+
+#include <vulkan/vulkan.h>
+
+//a sub allocation handed out by MemoryAllocator, bind resources with memory + offset
+struct Allocation
+{
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = 0;
+	void* mapped = nullptr; //only set for host visible memory, blocks stay mapped for their whole lifetime
+	uint32_t memoryType = 0;
+	uint32_t blockIndex = 0;
+};
+
+struct MemoryAllocatorStats
+{
+	uint32_t blockCount = 0;
+	uint32_t dedicatedAllocationCount = 0;
+	uint32_t allocationCount = 0;
+	uint64_t totalAllocationCount = 0;
+	uint64_t deviceAllocationCallCount = 0;
+	VkDeviceSize bytesReserved = 0;
+	VkDeviceSize bytesUsed = 0;
+	VkDeviceSize peakBytesUsed = 0;
+};
+
+//hands out ranges of large VkDeviceMemory blocks instead of calling vkAllocateMemory per resource
+//each memory type gets its own list of blocks, every block keeps an offset ordered free list that is coalesced on free
+class MemoryAllocator
+{
+	public:
+		static const VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+		static const uint32_t DEDICATED_BLOCK = UINT32_MAX;
+
+		void init(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize preferredBlockSize = DEFAULT_BLOCK_SIZE)
+		{
+			this->device = device;
+			this->preferredBlockSize = preferredBlockSize;
+
+			vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+
+			VkPhysicalDeviceProperties deviceProperties;
+			vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+			bufferImageGranularity = std::max<VkDeviceSize>(1, deviceProperties.limits.bufferImageGranularity);
+			maxMemoryAllocationCount = deviceProperties.limits.maxMemoryAllocationCount;
+
+			blocks.resize(memProperties.memoryTypeCount);
+		}
+
+		void destroy()
+		{
+			for(auto& typeBlocks : blocks)
+			{
+				for(auto& block : typeBlocks)
+				{
+					if(block.memory != VK_NULL_HANDLE)
+					{
+						if(block.ranges.size() != 1 || !block.ranges.begin()->second.free)
+						{
+							std::cerr << "memory allocator: destroying a block that still has live allocations\n";
+						}
+						releaseBlock(block);
+					}
+				}
+				typeBlocks.clear();
+			}
+		}
+
+		//linear is true for buffers and linearly tiled images, false for optimally tiled images
+		Allocation allocate(const VkMemoryRequirements& requirements, uint32_t memoryType, bool linear)
+		{
+			Allocation allocation = {};
+			allocation.memoryType = memoryType;
+			allocation.size = requirements.size;
+
+			//lazily allocated memory is only backed when the tiler has to spill, so it is never shared with other resources in a block
+			VkDeviceSize blockSize = getBlockSize(memoryType);
+			if(requirements.size > blockSize / 2 || (memProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT))
+			{
+				Block block = createBlock(memoryType, requirements.size);
+				allocation.memory = block.memory;
+				allocation.offset = 0;
+				allocation.mapped = block.mapped;
+				allocation.blockIndex = DEDICATED_BLOCK;
+				stats.dedicatedAllocationCount++;
+				trackAllocation(requirements.size);
+				return allocation;
+			}
+
+			auto& typeBlocks = blocks[memoryType];
+			for(uint32_t i = 0; i < typeBlocks.size(); i++)
+			{
+				Block& block = typeBlocks[i];
+				if(block.memory == VK_NULL_HANDLE || block.freeBytes < requirements.size)
+				{
+					continue;
+				}
+
+				if(allocateFromBlock(block, requirements, linear, allocation.offset))
+				{
+					allocation.memory = block.memory;
+					allocation.mapped = block.mapped != nullptr ? static_cast<char*>(block.mapped) + allocation.offset : nullptr;
+					allocation.blockIndex = i;
+					trackAllocation(requirements.size);
+					return allocation;
+				}
+			}
+
+			//no room in any existing block, reuse an empty slot or append a new block
+			uint32_t blockIndex = static_cast<uint32_t>(typeBlocks.size());
+			for(uint32_t i = 0; i < typeBlocks.size(); i++)
+			{
+				if(typeBlocks[i].memory == VK_NULL_HANDLE)
+				{
+					blockIndex = i;
+					break;
+				}
+			}
+			if(blockIndex == typeBlocks.size())
+			{
+				typeBlocks.emplace_back();
+			}
+
+			Block& block = typeBlocks[blockIndex];
+			block = createBlock(memoryType, blockSize);
+			stats.blockCount++;
+
+			if(!allocateFromBlock(block, requirements, linear, allocation.offset))
+			{
+				throw std::runtime_error("failed to sub allocate from a new memory block!");
+			}
+
+			allocation.memory = block.memory;
+			allocation.mapped = block.mapped != nullptr ? static_cast<char*>(block.mapped) + allocation.offset : nullptr;
+			allocation.blockIndex = blockIndex;
+			trackAllocation(requirements.size);
+			return allocation;
+		}
+
+		void free(Allocation& allocation)
+		{
+			if(allocation.memory == VK_NULL_HANDLE)
+			{
+				return;
+			}
+
+			stats.allocationCount--;
+			stats.bytesUsed -= allocation.size;
+
+			if(allocation.blockIndex == DEDICATED_BLOCK)
+			{
+				if(allocation.mapped != nullptr)
+				{
+					vkUnmapMemory(device, allocation.memory);
+				}
+				vkFreeMemory(device, allocation.memory, nullptr);
+				liveDeviceAllocations--;
+				stats.dedicatedAllocationCount--;
+				stats.bytesReserved -= allocation.size;
+				allocation = {};
+				return;
+			}
+
+			auto& typeBlocks = blocks[allocation.memoryType];
+			Block& block = typeBlocks[allocation.blockIndex];
+
+			auto it = block.ranges.find(allocation.offset);
+			if(it == block.ranges.end() || it->second.free)
+			{
+				throw std::runtime_error("freeing an allocation that does not belong to the allocator!");
+			}
+
+			it->second.free = true;
+			block.freeBytes += it->second.size;
+
+			//merge with the following range
+			auto next = std::next(it);
+			if(next != block.ranges.end() && next->second.free)
+			{
+				it->second.size += next->second.size;
+				block.ranges.erase(next);
+			}
+
+			//merge with the previous range
+			if(it != block.ranges.begin())
+			{
+				auto prev = std::prev(it);
+				if(prev->second.free)
+				{
+					prev->second.size += it->second.size;
+					block.ranges.erase(it);
+				}
+			}
+
+			//keep one empty block per memory type around so allocate/free churn does not hit the driver
+			if(block.freeBytes == block.size)
+			{
+				uint32_t liveBlocks = 0;
+				for(const auto& other : typeBlocks)
+				{
+					if(other.memory != VK_NULL_HANDLE) liveBlocks++;
+				}
+
+				if(liveBlocks > 1)
+				{
+					releaseBlock(block);
+					stats.blockCount--;
+				}
+			}
+
+			allocation = {};
+		}
+
+		uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const
+		{
+			for(uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
+			{
+				if((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
+				{
+					return i;
+				}
+			}
+
+			throw std::runtime_error("failed to find suitable memory type!");
+		}
+
+		//for optional properties like LAZILY_ALLOCATED, which only tiled gpus offer
+		bool hasMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const
+		{
+			for(uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
+			{
+				if((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
+				{
+					return true;
+				}
+			}
+			return false;
+		}
+
+		const MemoryAllocatorStats& getStats() const
+		{
+			return stats;
+		}
+
+		void printStats(std::ostream& out) const
+		{
+			out << "memory allocator:\n";
+			out << "\t  blocks: " << stats.blockCount << " (+" << stats.dedicatedAllocationCount << " dedicated)\n";
+			out << "\t  live allocations: " << stats.allocationCount << ", lifetime allocations: " << stats.totalAllocationCount << "\n";
+			out << "\t  vkAllocateMemory calls: " << stats.deviceAllocationCallCount << " (limit " << maxMemoryAllocationCount << ")\n";
+			out << "\t  reserved: " << stats.bytesReserved / 1024 << " KiB, used: " << stats.bytesUsed / 1024 << " KiB, peak used: " << stats.peakBytesUsed / 1024 << " KiB\n";
+		}
+
+	private:
+		struct Range
+		{
+			VkDeviceSize size;
+			bool free;
+			bool linear;
+		};
+
+		struct Block
+		{
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+			VkDeviceSize size = 0;
+			VkDeviceSize freeBytes = 0;
+			void* mapped = nullptr;
+			std::map<VkDeviceSize, Range> ranges; //keyed by offset
+		};
+
+		VkDevice device = VK_NULL_HANDLE;
+		VkPhysicalDeviceMemoryProperties memProperties = {};
+		VkDeviceSize preferredBlockSize = DEFAULT_BLOCK_SIZE;
+		VkDeviceSize bufferImageGranularity = 1;
+		uint32_t maxMemoryAllocationCount = 0;
+		uint32_t liveDeviceAllocations = 0;
+
+		std::vector<std::vector<Block>> blocks; //indexed by memory type
+
+		MemoryAllocatorStats stats;
+
+		static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+		{
+			return (value + alignment - 1) & ~(alignment - 1);
+		}
+
+		//true if the last byte of resource a and the first byte of resource b share a bufferImageGranularity page
+		static bool onSamePage(VkDeviceSize aOffset, VkDeviceSize aSize, VkDeviceSize bOffset, VkDeviceSize pageSize)
+		{
+			VkDeviceSize aEndPage = (aOffset + aSize - 1) & ~(pageSize - 1);
+			VkDeviceSize bStartPage = bOffset & ~(pageSize - 1);
+			return aEndPage == bStartPage;
+		}
+
+		VkDeviceSize getBlockSize(uint32_t memoryType) const
+		{
+			//small heaps (integrated gpus, the host visible device local window) get proportionally smaller blocks
+			VkDeviceSize heapSize = memProperties.memoryHeaps[memProperties.memoryTypes[memoryType].heapIndex].size;
+			if(heapSize <= 1024ull * 1024 * 1024)
+			{
+				return std::min(preferredBlockSize, alignUp(heapSize / 8, 32));
+			}
+			return preferredBlockSize;
+		}
+
+		Block createBlock(uint32_t memoryType, VkDeviceSize size)
+		{
+			if(maxMemoryAllocationCount != 0 && liveDeviceAllocations >= maxMemoryAllocationCount)
+			{
+				throw std::runtime_error("exceeded maxMemoryAllocationCount!");
+			}
+
+			VkMemoryAllocateInfo allocInfo = {};
+			allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+			allocInfo.allocationSize = size;
+			allocInfo.memoryTypeIndex = memoryType;
+
+			Block block;
+			if(vkAllocateMemory(device, &allocInfo, nullptr, &block.memory) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to allocate device memory block!");
+			}
+			liveDeviceAllocations++;
+			stats.deviceAllocationCallCount++;
+			stats.bytesReserved += size;
+
+			if(memProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+			{
+				if(vkMapMemory(device, block.memory, 0, VK_WHOLE_SIZE, 0, &block.mapped) != VK_SUCCESS)
+				{
+					throw std::runtime_error("failed to map device memory block!");
+				}
+			}
+
+			block.size = size;
+			block.freeBytes = size;
+			block.ranges[0] = {size, true, true};
+
+			return block;
+		}
+
+		void releaseBlock(Block& block)
+		{
+			if(block.mapped != nullptr)
+			{
+				vkUnmapMemory(device, block.memory);
+			}
+			vkFreeMemory(device, block.memory, nullptr);
+			liveDeviceAllocations--;
+			stats.bytesReserved -= block.size;
+			block = Block();
+		}
+
+		//first fit search of the free list, honouring alignment and bufferImageGranularity between linear and optimal neighbours
+		bool allocateFromBlock(Block& block, const VkMemoryRequirements& requirements, bool linear, VkDeviceSize& outOffset)
+		{
+			for(auto it = block.ranges.begin(); it != block.ranges.end(); it++)
+			{
+				if(!it->second.free || it->second.size < requirements.size)
+				{
+					continue;
+				}
+
+				VkDeviceSize rangeStart = it->first;
+				VkDeviceSize rangeEnd = rangeStart + it->second.size;
+				VkDeviceSize offset = alignUp(rangeStart, requirements.alignment);
+
+				//free ranges are always coalesced, so the neighbours of a free range are in use
+				if(bufferImageGranularity > 1 && it != block.ranges.begin())
+				{
+					auto prev = std::prev(it);
+					if(prev->second.linear != linear && onSamePage(prev->first, prev->second.size, offset, bufferImageGranularity))
+					{
+						offset = alignUp(offset, bufferImageGranularity);
+					}
+				}
+
+				if(offset + requirements.size > rangeEnd)
+				{
+					continue;
+				}
+
+				auto next = std::next(it);
+				if(bufferImageGranularity > 1 && next != block.ranges.end())
+				{
+					if(next->second.linear != linear && onSamePage(offset, requirements.size, next->first, bufferImageGranularity))
+					{
+						continue;
+					}
+				}
+
+				//split the free range into [padding][allocation][tail]
+				block.ranges.erase(it);
+				if(offset > rangeStart)
+				{
+					block.ranges[rangeStart] = {offset - rangeStart, true, linear};
+				}
+				block.ranges[offset] = {requirements.size, false, linear};
+				if(offset + requirements.size < rangeEnd)
+				{
+					block.ranges[offset + requirements.size] = {rangeEnd - (offset + requirements.size), true, linear};
+				}
+
+				block.freeBytes -= requirements.size;
+				outOffset = offset;
+				return true;
+			}
+			return false;
+		}
+
+		void trackAllocation(VkDeviceSize size)
+		{
+			stats.allocationCount++;
+			stats.totalAllocationCount++;
+			stats.bytesUsed += size;
+			stats.peakBytesUsed = std::max(stats.peakBytesUsed, stats.bytesUsed);
+		}
+};
@@ -0,0 +1,226 @@
+#pragma once
+
+#include "pch.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+//binary mesh file written by tools/meshconv and read in place through mmap
+//layout: MeshFileHeader, MeshAttribute[attributeCount], MeshSubmesh[submeshCount], vertex data, index data
+//every section starts on a MESH_SECTION_ALIGNMENT boundary, all values are little endian
+const char MESH_FILE_MAGIC[4] = {'M', 'S', 'H', 'B'};
+const uint32_t MESH_FILE_VERSION = 1;
+const uint64_t MESH_SECTION_ALIGNMENT = 16;
+
+enum MeshAttributeSemantic : uint32_t
+{
+	MESH_SEMANTIC_POSITION = 0,
+	MESH_SEMANTIC_COLOR = 1,
+	MESH_SEMANTIC_TEXCOORD = 2,
+	MESH_SEMANTIC_NORMAL = 3
+};
+
+//kept independent of vulkan so the converter does not need the sdk, the loader maps them to VkFormat
+enum MeshAttributeFormat : uint32_t
+{
+	MESH_FORMAT_FLOAT2 = 0,
+	MESH_FORMAT_FLOAT3 = 1,
+	MESH_FORMAT_FLOAT4 = 2
+};
+
+struct MeshAttribute
+{
+	uint32_t semantic;
+	uint32_t format;
+	uint32_t offset;
+	uint32_t reserved;
+};
+
+//one draw, vertexOffset is added to every index so 16 bit indices can address large meshes per submesh
+struct MeshSubmesh
+{
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	int32_t vertexOffset;
+	uint32_t materialIndex;
+	float boundsMin[3];
+	float boundsMax[3];
+};
+
+struct MeshFileHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t vertexCount;
+	uint32_t vertexStride;
+	uint32_t attributeCount;
+	uint32_t indexSize; //2 or 4 bytes
+	uint32_t indexCount;
+	uint32_t submeshCount;
+	uint64_t attributesOffset;
+	uint64_t submeshesOffset;
+	uint64_t vertexDataOffset;
+	uint64_t vertexDataSize;
+	uint64_t indexDataOffset;
+	uint64_t indexDataSize;
+	float boundsMin[3];
+	float boundsMax[3];
+};
+
+inline uint64_t alignMeshSection(uint64_t offset)
+{
+	return (offset + MESH_SECTION_ALIGNMENT - 1) & ~(MESH_SECTION_ALIGNMENT - 1);
+}
+
+//read only view of a mesh file, the pointers stay valid until close()
+//the vertex and index sections are handed to the upload engine directly so nothing is copied on the way to the staging ring
+class MappedMesh
+{
+	public:
+		MappedMesh() = default;
+		MappedMesh(const MappedMesh&) = delete;
+		MappedMesh& operator=(const MappedMesh&) = delete;
+
+		~MappedMesh()
+		{
+			close();
+		}
+
+		void open(const std::string& path)
+		{
+			close();
+
+			int file = ::open(path.c_str(), O_RDONLY);
+			if(file < 0)
+			{
+				throw std::runtime_error("failed to open mesh " + path + "!");
+			}
+
+			struct stat fileStat;
+			if(fstat(file, &fileStat) != 0 || static_cast<uint64_t>(fileStat.st_size) < sizeof(MeshFileHeader))
+			{
+				::close(file);
+				throw std::runtime_error("mesh " + path + " is too small!");
+			}
+			mappedSize = static_cast<size_t>(fileStat.st_size);
+
+			void* mapping = mmap(nullptr, mappedSize, PROT_READ, MAP_PRIVATE, file, 0);
+			::close(file);
+			if(mapping == MAP_FAILED)
+			{
+				throw std::runtime_error("failed to map mesh " + path + "!");
+			}
+			mapped = static_cast<const char*>(mapping);
+
+			//the file is consumed front to back exactly once, start reading ahead right away
+			madvise(mapping, mappedSize, MADV_SEQUENTIAL);
+			madvise(mapping, mappedSize, MADV_WILLNEED);
+
+			try
+			{
+				validate(path);
+			}
+			catch(...)
+			{
+				close();
+				throw;
+			}
+		}
+
+		void close()
+		{
+			if(mapped != nullptr)
+			{
+				munmap(const_cast<char*>(mapped), mappedSize);
+				mapped = nullptr;
+				mappedSize = 0;
+			}
+		}
+
+		bool isOpen() const
+		{
+			return mapped != nullptr;
+		}
+
+		const MeshFileHeader& header() const
+		{
+			return *reinterpret_cast<const MeshFileHeader*>(mapped);
+		}
+
+		const MeshAttribute* attributes() const
+		{
+			return reinterpret_cast<const MeshAttribute*>(mapped + header().attributesOffset);
+		}
+
+		const MeshSubmesh* submeshes() const
+		{
+			return reinterpret_cast<const MeshSubmesh*>(mapped + header().submeshesOffset);
+		}
+
+		const void* vertexData() const
+		{
+			return mapped + header().vertexDataOffset;
+		}
+
+		const void* indexData() const
+		{
+			return mapped + header().indexDataOffset;
+		}
+
+		//returns the attribute with this semantic or nullptr
+		const MeshAttribute* findAttribute(MeshAttributeSemantic semantic) const
+		{
+			for(uint32_t i = 0; i < header().attributeCount; i++)
+			{
+				if(attributes()[i].semantic == semantic)
+				{
+					return &attributes()[i];
+				}
+			}
+			return nullptr;
+		}
+
+	private:
+		const char* mapped = nullptr;
+		size_t mappedSize = 0;
+
+		bool sectionFits(uint64_t offset, uint64_t size) const
+		{
+			return offset % MESH_SECTION_ALIGNMENT == 0 && offset <= mappedSize && size <= mappedSize - offset;
+		}
+
+		void validate(const std::string& path) const
+		{
+			const MeshFileHeader& fileHeader = header();
+			if(memcmp(fileHeader.magic, MESH_FILE_MAGIC, sizeof(MESH_FILE_MAGIC)) != 0 || fileHeader.version != MESH_FILE_VERSION)
+			{
+				throw std::runtime_error(path + " is not a version " + std::to_string(MESH_FILE_VERSION) + " mesh file!");
+			}
+			if(fileHeader.indexSize != 2 && fileHeader.indexSize != 4)
+			{
+				throw std::runtime_error("mesh " + path + " has an invalid index size!");
+			}
+
+			bool sectionsValid = sectionFits(fileHeader.attributesOffset, static_cast<uint64_t>(fileHeader.attributeCount) * sizeof(MeshAttribute))
+				&& sectionFits(fileHeader.submeshesOffset, static_cast<uint64_t>(fileHeader.submeshCount) * sizeof(MeshSubmesh))
+				&& sectionFits(fileHeader.vertexDataOffset, fileHeader.vertexDataSize)
+				&& sectionFits(fileHeader.indexDataOffset, fileHeader.indexDataSize)
+				&& fileHeader.vertexDataSize == static_cast<uint64_t>(fileHeader.vertexCount) * fileHeader.vertexStride
+				&& fileHeader.indexDataSize == static_cast<uint64_t>(fileHeader.indexCount) * fileHeader.indexSize;
+			if(!sectionsValid)
+			{
+				throw std::runtime_error("mesh " + path + " is truncated or corrupt!");
+			}
+
+			for(uint32_t i = 0; i < fileHeader.submeshCount; i++)
+			{
+				const MeshSubmesh& submesh = submeshes()[i];
+				if(static_cast<uint64_t>(submesh.firstIndex) + submesh.indexCount > fileHeader.indexCount || submesh.vertexOffset < 0 || static_cast<uint32_t>(submesh.vertexOffset) >= std::max(fileHeader.vertexCount, 1u))
+				{
+					throw std::runtime_error("mesh " + path + " has an out of range submesh!");
+				}
+			}
+		}
+};
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "pch.h"
+
+#include <vulkan/vulkan.h>
+
+#include <thread>
+#include <deque>
+
+enum PresentProfile : uint32_t
+{
+	PRESENT_PROFILE_DEFAULT,
+	PRESENT_PROFILE_LOW_LATENCY,
+	PRESENT_PROFILE_THROUGHPUT,
+	PRESENT_PROFILE_POWER_SAVING,
+	PRESENT_PROFILE_COUNT
+};
+
+struct PresentProfileSettings
+{
+	const char* name;
+	//the first mode the surface supports is used, FIFO is always supported and ends every list
+	std::vector<VkPresentModeKHR> presentModes;
+	//swapchain images requested on top of the surface's minimum
+	uint32_t extraImages;
+	//frames the cpu may record ahead of the gpu, 0 keeps --frames-in-flight
+	uint32_t framesInFlight;
+	//frames per second the frame limiter allows, 0 does not limit
+	double frameLimit;
+};
+
+//low latency trades tearing and throughput for the shortest queue, throughput keeps the queues full,
+//power saving renders no faster than FIFO allows and at most 30 frames per second
+inline const PresentProfileSettings& getPresentProfileSettings(PresentProfile profile)
+{
+	static const PresentProfileSettings settings[PRESENT_PROFILE_COUNT] = {
+		{"default", {VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_KHR}, 1, 0, 0.0},
+		{"low-latency", {VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_KHR}, 0, 1, 0.0},
+		{"throughput", {VK_PRESENT_MODE_FIFO_RELAXED_KHR, VK_PRESENT_MODE_FIFO_KHR}, 2, 3, 0.0},
+		{"power-saving", {VK_PRESENT_MODE_FIFO_KHR}, 1, 2, 30.0}
+	};
+	return settings[profile];
+}
+
+//returns false for an unknown name
+inline bool parsePresentProfile(const std::string& name, PresentProfile& profile)
+{
+	for(uint32_t i = 0; i < PRESENT_PROFILE_COUNT; i++)
+	{
+		if(name == getPresentProfileSettings(static_cast<PresentProfile>(i)).name)
+		{
+			profile = static_cast<PresentProfile>(i);
+			return true;
+		}
+	}
+	return false;
+}
+
+//sleeps so frames start no more often than the limit, a frame that runs late moves the schedule instead of causing a burst
+class FrameLimiter
+{
+	public:
+		void setLimit(double framesPerSecond)
+		{
+			interval = framesPerSecond > 0.0 ? std::chrono::duration<double>(1.0 / framesPerSecond) : std::chrono::duration<double>(0.0);
+			nextFrame = std::chrono::steady_clock::now();
+		}
+
+		void wait()
+		{
+			if(interval.count() == 0.0)
+			{
+				return;
+			}
+
+			auto now = std::chrono::steady_clock::now();
+			if(now < nextFrame)
+			{
+				std::this_thread::sleep_until(nextFrame);
+				now = nextFrame;
+			}
+			nextFrame = now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(interval);
+		}
+
+	private:
+		std::chrono::duration<double> interval = std::chrono::duration<double>(0.0);
+		std::chrono::steady_clock::time_point nextFrame;
+};
+
+//time from sampling a frame's input to the gpu finishing it, collected separately for every present profile
+//completion is noticed when the next frame starts, so the samples are at most one cpu frame late
+class LatencyTracker
+{
+	public:
+		void beginFrame(uint64_t frameNumber, PresentProfile profile, std::chrono::steady_clock::time_point inputTime)
+		{
+			pending.push_back({frameNumber, profile, inputTime});
+		}
+
+		//records every pending frame isComplete reports done, frames complete in order so the oldest is checked first
+		template<typename IsComplete>
+		void collect(IsComplete isComplete)
+		{
+			auto now = std::chrono::steady_clock::now();
+			while(!pending.empty() && isComplete(pending.front().frameNumber))
+			{
+				double latency = std::chrono::duration<double, std::milli>(now - pending.front().inputTime).count();
+				Samples& samples = profileSamples[pending.front().profile];
+				samples.count++;
+				samples.total += latency;
+				samples.max = std::max(samples.max, latency);
+				pending.pop_front();
+			}
+		}
+
+		void printStats(std::ostream& out) const
+		{
+			for(uint32_t i = 0; i < PRESENT_PROFILE_COUNT; i++)
+			{
+				const Samples& samples = profileSamples[i];
+				if(samples.count == 0)
+				{
+					continue;
+				}
+				out << "present profile " << getPresentProfileSettings(static_cast<PresentProfile>(i)).name << ": input to completion " << samples.total / samples.count << " ms average, " << samples.max << " ms max over " << samples.count << " frames\n";
+			}
+		}
+
+	private:
+		struct PendingFrame
+		{
+			uint64_t frameNumber;
+			PresentProfile profile;
+			std::chrono::steady_clock::time_point inputTime;
+		};
+
+		struct Samples
+		{
+			uint64_t count = 0;
+			double total = 0.0;
+			double max = 0.0;
+		};
+
+		std::deque<PendingFrame> pending;
+		std::array<Samples, PRESENT_PROFILE_COUNT> profileSamples;
+};
@@ -0,0 +1,362 @@
+#pragma once
+
+#include "pch.h"
+
+#include <vulkan/vulkan.h>
+
+//one timed section of a frame, times are in microseconds from the profiler's start
+struct ProfileZone
+{
+	const char* name;
+	double start;
+	double duration;
+};
+
+struct FrameProfileRecord
+{
+	static const uint32_t MAX_CPU_ZONES = 16;
+	static const uint32_t MAX_GPU_ZONES = 8;
+
+	uint64_t frameNumber = 0;
+	double cpuStart = 0.0;
+	double cpuDuration = 0.0;
+	std::array<ProfileZone, MAX_CPU_ZONES> cpuZones;
+	uint32_t cpuZoneCount = 0;
+	std::array<ProfileZone, MAX_GPU_ZONES> gpuZones;
+	uint32_t gpuZoneCount = 0;
+};
+
+//cpu zones and gpu timestamp queries per frame, kept in a fixed ring of the most recent frames
+//nothing is allocated after init and the gpu results are read once per frame after its fence, so it can stay enabled
+//zone names must be string literals, only the pointer is stored
+class FrameProfiler
+{
+	public:
+		static const uint32_t HISTORY_SIZE = 512;
+
+		//timestampValidBits is the graphics queue family's, 0 disables the gpu zones
+		void init(VkDevice device, float timestampPeriod, uint32_t timestampValidBits, uint32_t framesInFlight)
+		{
+			this->device = device;
+			this->timestampPeriod = timestampPeriod;
+			this->framesInFlight = framesInFlight;
+			gpuEnabled = timestampValidBits > 0;
+			timestampMask = timestampValidBits >= 64 ? ~0ull : (1ull << timestampValidBits) - 1;
+
+			startTime = std::chrono::steady_clock::now();
+			records.resize(HISTORY_SIZE);
+			slots.resize(framesInFlight);
+
+			if(!gpuEnabled)
+			{
+				return;
+			}
+
+			VkQueryPoolCreateInfo queryPoolInfo = {};
+			queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+			queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+			queryPoolInfo.queryCount = framesInFlight * QUERIES_PER_FRAME;
+
+			if(vkCreateQueryPool(device, &queryPoolInfo, nullptr, &queryPool) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create timestamp query pool!");
+			}
+		}
+
+		void destroy()
+		{
+			if(queryPool != VK_NULL_HANDLE)
+			{
+				vkDestroyQueryPool(device, queryPool, nullptr);
+				queryPool = VK_NULL_HANDLE;
+			}
+		}
+
+		bool hasGpuTimestamps() const
+		{
+			return gpuEnabled;
+		}
+
+		double now() const
+		{
+			return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - startTime).count();
+		}
+
+		//starts the record for a new frame, frameSlot is the frame in flight index whose queries it will use
+		void beginFrame(uint64_t frameNumber, uint32_t frameSlot)
+		{
+			currentSlot = frameSlot;
+			currentRecordIndex = recordedFrameCount;
+			currentRecord = &records[currentRecordIndex % HISTORY_SIZE];
+			*currentRecord = {};
+			currentRecord->frameNumber = frameNumber;
+			currentRecord->cpuStart = now();
+			recordedFrameCount++;
+		}
+
+		void endFrame()
+		{
+			currentRecord->cpuDuration = now() - currentRecord->cpuStart;
+		}
+
+		void addCpuZone(const char* name, double start, double end)
+		{
+			if(currentRecord == nullptr || currentRecord->cpuZoneCount == FrameProfileRecord::MAX_CPU_ZONES)
+			{
+				return;
+			}
+			currentRecord->cpuZones[currentRecord->cpuZoneCount++] = {name, start, end - start};
+		}
+
+		//adds a gpu zone measured elsewhere, e.g. by the upload engine, in raw timestamp ticks
+		void addGpuZoneTicks(const char* name, uint64_t beginTicks, uint64_t endTicks)
+		{
+			if(currentRecord == nullptr || currentRecord->gpuZoneCount == FrameProfileRecord::MAX_GPU_ZONES)
+			{
+				return;
+			}
+			currentRecord->gpuZones[currentRecord->gpuZoneCount++] = {name, ticksToMicroseconds(beginTicks), ticksToMicroseconds((endTicks - beginTicks) & timestampMask)};
+		}
+
+		//resets this frame's queries, must be recorded outside a render pass before any gpu zone
+		void resetGpuZones(VkCommandBuffer commandBuffer)
+		{
+			Slot& slot = slots[currentSlot];
+			slot.zoneCount = 0;
+			slot.recordIndex = currentRecordIndex;
+			slot.frameNumber = currentRecord->frameNumber;
+			slot.pending = gpuEnabled;
+
+			if(gpuEnabled)
+			{
+				vkCmdResetQueryPool(commandBuffer, queryPool, currentSlot * QUERIES_PER_FRAME, QUERIES_PER_FRAME);
+			}
+		}
+
+		//returns the zone index to pass to endGpuZone
+		uint32_t beginGpuZone(VkCommandBuffer commandBuffer, const char* name, VkPipelineStageFlagBits stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT)
+		{
+			Slot& slot = slots[currentSlot];
+			if(!gpuEnabled || slot.zoneCount == FrameProfileRecord::MAX_GPU_ZONES)
+			{
+				return UINT32_MAX;
+			}
+
+			uint32_t zone = slot.zoneCount++;
+			slot.zoneNames[zone] = name;
+			vkCmdWriteTimestamp(commandBuffer, stage, queryPool, currentSlot * QUERIES_PER_FRAME + zone * 2);
+			return zone;
+		}
+
+		void endGpuZone(VkCommandBuffer commandBuffer, uint32_t zone, VkPipelineStageFlagBits stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT)
+		{
+			if(zone == UINT32_MAX)
+			{
+				return;
+			}
+			vkCmdWriteTimestamp(commandBuffer, stage, queryPool, currentSlot * QUERIES_PER_FRAME + zone * 2 + 1);
+		}
+
+		//reads back the queries the previous user of frameSlot wrote, call once that frame's fence has been waited on
+		void resolveGpuZones(uint32_t frameSlot)
+		{
+			Slot& slot = slots[frameSlot];
+			if(!slot.pending)
+			{
+				return;
+			}
+			slot.pending = false;
+
+			//the record may already have been overwritten if the history is shorter than the frames in flight
+			FrameProfileRecord& record = records[slot.recordIndex % HISTORY_SIZE];
+			if(record.frameNumber != slot.frameNumber || slot.zoneCount == 0)
+			{
+				return;
+			}
+
+			std::array<uint64_t, QUERIES_PER_FRAME> ticks;
+			if(vkGetQueryPoolResults(device, queryPool, frameSlot * QUERIES_PER_FRAME, slot.zoneCount * 2, sizeof(uint64_t) * slot.zoneCount * 2, ticks.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+			{
+				return;
+			}
+
+			for(uint32_t i = 0; i < slot.zoneCount && record.gpuZoneCount < FrameProfileRecord::MAX_GPU_ZONES; i++)
+			{
+				uint64_t begin = ticks[i * 2] & timestampMask;
+				uint64_t end = ticks[i * 2 + 1] & timestampMask;
+				record.gpuZones[record.gpuZoneCount++] = {slot.zoneNames[i], ticksToMicroseconds(begin), ticksToMicroseconds((end - begin) & timestampMask)};
+			}
+		}
+
+		//average duration of every zone over the frames still in the history
+		void printSummary(std::ostream& out) const
+		{
+			std::map<std::string, std::pair<double, uint32_t>> cpuTotals;
+			std::map<std::string, std::pair<double, uint32_t>> gpuTotals;
+			forEachRecord([&](const FrameProfileRecord& record)
+			{
+				auto& frameTotal = cpuTotals["frame"];
+				frameTotal.first += record.cpuDuration;
+				frameTotal.second++;
+				for(uint32_t i = 0; i < record.cpuZoneCount; i++)
+				{
+					auto& total = cpuTotals[record.cpuZones[i].name];
+					total.first += record.cpuZones[i].duration;
+					total.second++;
+				}
+				for(uint32_t i = 0; i < record.gpuZoneCount; i++)
+				{
+					auto& total = gpuTotals[record.gpuZones[i].name];
+					total.first += record.gpuZones[i].duration;
+					total.second++;
+				}
+			});
+
+			out << "frame profile (average over the last " << std::min<uint64_t>(recordedFrameCount, HISTORY_SIZE) << " frames):\n";
+			for(const auto& total : cpuTotals)
+			{
+				out << "\t  cpu " << total.first << ": " << total.second.first / total.second.second / 1000.0 << " ms\n";
+			}
+			for(const auto& total : gpuTotals)
+			{
+				out << "\t  gpu " << total.first << ": " << total.second.first / total.second.second / 1000.0 << " ms\n";
+			}
+		}
+
+		//format is csv, json or chrome (trace event format, loads in chrome://tracing and perfetto)
+		void exportHistory(const std::string& path, const std::string& format) const
+		{
+			std::ofstream file(path, std::ios::trunc);
+			if(!file.is_open())
+			{
+				throw std::runtime_error("failed to open profile output file!");
+			}
+
+			if(format == "csv")
+			{
+				file << "frame,timeline,zone,start_us,duration_us\n";
+				forEachRecord([&](const FrameProfileRecord& record)
+				{
+					file << record.frameNumber << ",cpu,frame," << record.cpuStart << "," << record.cpuDuration << "\n";
+					for(uint32_t i = 0; i < record.cpuZoneCount; i++)
+					{
+						file << record.frameNumber << ",cpu," << record.cpuZones[i].name << "," << record.cpuZones[i].start << "," << record.cpuZones[i].duration << "\n";
+					}
+					for(uint32_t i = 0; i < record.gpuZoneCount; i++)
+					{
+						file << record.frameNumber << ",gpu," << record.gpuZones[i].name << "," << record.gpuZones[i].start << "," << record.gpuZones[i].duration << "\n";
+					}
+				});
+			}
+			else if(format == "json")
+			{
+				bool firstRecord = true;
+				file << "{\"frames\":[\n";
+				forEachRecord([&](const FrameProfileRecord& record)
+				{
+					file << (firstRecord ? "" : ",\n") << "{\"frame\":" << record.frameNumber << ",\"start_us\":" << record.cpuStart << ",\"duration_us\":" << record.cpuDuration;
+					file << ",\"cpu\":[";
+					for(uint32_t i = 0; i < record.cpuZoneCount; i++)
+					{
+						file << (i == 0 ? "" : ",") << "{\"zone\":\"" << record.cpuZones[i].name << "\",\"start_us\":" << record.cpuZones[i].start << ",\"duration_us\":" << record.cpuZones[i].duration << "}";
+					}
+					file << "],\"gpu\":[";
+					for(uint32_t i = 0; i < record.gpuZoneCount; i++)
+					{
+						file << (i == 0 ? "" : ",") << "{\"zone\":\"" << record.gpuZones[i].name << "\",\"start_us\":" << record.gpuZones[i].start << ",\"duration_us\":" << record.gpuZones[i].duration << "}";
+					}
+					file << "]}";
+					firstRecord = false;
+				});
+				file << "\n]}\n";
+			}
+			else if(format == "chrome")
+			{
+				//gpu timestamps have their own epoch, the gpu track is shifted so each frame's first gpu zone lines up with its cpu start
+				bool firstEvent = true;
+				auto event = [&](const char* name, uint32_t thread, double start, double duration, uint64_t frameNumber)
+				{
+					file << (firstEvent ? "" : ",\n") << "{\"name\":\"" << name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread << ",\"ts\":" << start << ",\"dur\":" << duration << ",\"args\":{\"frame\":" << frameNumber << "}}";
+					firstEvent = false;
+				};
+
+				file << "{\"traceEvents\":[\n";
+				file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"cpu\"}},\n";
+				file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"gpu\"}},\n";
+				forEachRecord([&](const FrameProfileRecord& record)
+				{
+					event("frame", 1, record.cpuStart, record.cpuDuration, record.frameNumber);
+					for(uint32_t i = 0; i < record.cpuZoneCount; i++)
+					{
+						event(record.cpuZones[i].name, 1, record.cpuZones[i].start, record.cpuZones[i].duration, record.frameNumber);
+					}
+					if(record.gpuZoneCount > 0)
+					{
+						double gpuOrigin = record.gpuZones[0].start;
+						for(uint32_t i = 0; i < record.gpuZoneCount; i++)
+						{
+							gpuOrigin = std::min(gpuOrigin, record.gpuZones[i].start);
+						}
+						for(uint32_t i = 0; i < record.gpuZoneCount; i++)
+						{
+							event(record.gpuZones[i].name, 2, record.cpuStart + record.gpuZones[i].start - gpuOrigin, record.gpuZones[i].duration, record.frameNumber);
+						}
+					}
+				});
+				file << "\n]}\n";
+			}
+			else
+			{
+				throw std::runtime_error("unknown profile format " + format);
+			}
+		}
+
+	private:
+		static const uint32_t QUERIES_PER_FRAME = FrameProfileRecord::MAX_GPU_ZONES * 2;
+
+		//queries written by the frame currently using one frame in flight index
+		struct Slot
+		{
+			uint64_t recordIndex = 0;
+			uint64_t frameNumber = 0;
+			uint32_t zoneCount = 0;
+			std::array<const char*, FrameProfileRecord::MAX_GPU_ZONES> zoneNames;
+			bool pending = false;
+		};
+
+		VkDevice device;
+		VkQueryPool queryPool = VK_NULL_HANDLE;
+		float timestampPeriod = 1.0f;
+		uint64_t timestampMask = ~0ull;
+		bool gpuEnabled = false;
+		uint32_t framesInFlight = 0;
+
+		std::chrono::steady_clock::time_point startTime;
+		std::vector<FrameProfileRecord> records;
+		std::vector<Slot> slots;
+		FrameProfileRecord* currentRecord = nullptr;
+		uint64_t currentRecordIndex = 0;
+		uint32_t currentSlot = 0;
+		uint64_t recordedFrameCount = 0;
+
+		double ticksToMicroseconds(uint64_t ticks) const
+		{
+			return static_cast<double>(ticks) * timestampPeriod / 1000.0;
+		}
+
+		//oldest first, frames that never finished (e.g. dropped for a swapchain rebuild) are skipped
+		template<typename F>
+		void forEachRecord(F&& callback) const
+		{
+			uint64_t count = std::min<uint64_t>(recordedFrameCount, HISTORY_SIZE);
+			uint64_t first = recordedFrameCount - count;
+			for(uint64_t i = first; i < recordedFrameCount; i++)
+			{
+				const FrameProfileRecord& record = records[i % HISTORY_SIZE];
+				if(record.cpuDuration > 0.0)
+				{
+					callback(record);
+				}
+			}
+		}
+};
@@ -1,3 +1,6 @@
 /code-libraries/cpp/vulkan/latest/x86_64/bin/glslc shader.vert -o vert.spv
+/code-libraries/cpp/vulkan/latest/x86_64/bin/glslc shader_depth.vert -o vert_depth.spv
 /code-libraries/cpp/vulkan/latest/x86_64/bin/glslc shader.frag -o frag.spv
+/code-libraries/cpp/vulkan/latest/x86_64/bin/glslc shader_bindless.frag -o frag_bindless.spv
+/code-libraries/cpp/vulkan/latest/x86_64/bin/glslc cull.comp -o cull.spv
 
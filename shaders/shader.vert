@@ -3,20 +3,58 @@
 
 layout(binding = 0) uniform UniformBufferObject
 {
-    mat4 model;
     mat4 view;
     mat4 proj;
+    float spin;
 } ubo;
 
-layout(location = 0) in vec2 inPosition;
+layout(push_constant) uniform DrawPushConstants
+{
+    mat4 model;
+} draw;
+
+//set when the instances are frustum culled by shaders/cull.comp
+layout(constant_id = 0) const bool gpuCulling = false;
+
+struct InstanceData
+{
+    mat4 model;
+    vec4 tint;
+    uint textureIndex;
+};
+
+layout(std430, binding = 2) readonly buffer InstanceBuffer
+{
+    InstanceData instances[];
+};
+
+layout(std430, binding = 3) readonly buffer VisibleInstanceBuffer
+{
+    uint visibleInstances[];
+};
+
+layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
 layout(location = 2) in vec2 inTexCoord;
 
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) out vec4 fragTint;
+layout(location = 3) flat out uint fragTextureIndex;
+
+//the depth pre-pass runs shader_depth.vert, both must produce bit identical depth for the equal test
+invariant gl_Position;
 
 void main() {
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 0.0, 1.0);
+    uint instanceIndex = gpuCulling ? visibleInstances[gl_InstanceIndex] : gl_InstanceIndex;
+    InstanceData instance = instances[instanceIndex];
+    vec4 position = draw.model * vec4(inPosition, 1.0);
+    float c = cos(ubo.spin);
+    float s = sin(ubo.spin);
+    position.xy = vec2(c * position.x - s * position.y, s * position.x + c * position.y);
+    gl_Position = ubo.proj * ubo.view * instance.model * position;
     fragColor = inColor;
     fragTexCoord = inTexCoord;
+    fragTint = instance.tint;
+    fragTextureIndex = instance.textureIndex;
 }
\ No newline at end of file
@@ -0,0 +1,50 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(binding = 0) uniform UniformBufferObject
+{
+    mat4 view;
+    mat4 proj;
+    float spin;
+} ubo;
+
+layout(push_constant) uniform DrawPushConstants
+{
+    mat4 model;
+} draw;
+
+//set when the instances are frustum culled by shaders/cull.comp
+layout(constant_id = 0) const bool gpuCulling = false;
+
+struct InstanceData
+{
+    mat4 model;
+    vec4 tint;
+    uint textureIndex;
+};
+
+layout(std430, binding = 2) readonly buffer InstanceBuffer
+{
+    InstanceData instances[];
+};
+
+layout(std430, binding = 3) readonly buffer VisibleInstanceBuffer
+{
+    uint visibleInstances[];
+};
+
+//only the position stream is bound in the depth pre-pass
+layout(location = 0) in vec3 inPosition;
+
+//has to produce bit identical depth to shader.vert for the pre-pass equal test
+invariant gl_Position;
+
+void main() {
+    uint instanceIndex = gpuCulling ? visibleInstances[gl_InstanceIndex] : gl_InstanceIndex;
+    InstanceData instance = instances[instanceIndex];
+    vec4 position = draw.model * vec4(inPosition, 1.0);
+    float c = cos(ubo.spin);
+    float s = sin(ubo.spin);
+    position.xy = vec2(c * position.x - s * position.y, s * position.x + c * position.y);
+    gl_Position = ubo.proj * ubo.view * instance.model * position;
+}
\ No newline at end of file
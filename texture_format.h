@@ -0,0 +1,386 @@
+#pragma once
+
+#include "pch.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+//KTX2 container written by tools/texconv and read in place through mmap
+//only 2D textures with one layer, one face and no supercompression are accepted, all values are little endian
+const uint8_t KTX2_IDENTIFIER[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+//the subset of VkFormat values the loader understands, kept independent of vulkan so the converter does not need the sdk
+//the values are the VkFormat values, the file stores them as they are
+enum TextureFormat : uint32_t
+{
+	TEXTURE_FORMAT_R8G8B8A8_UNORM = 37,
+	TEXTURE_FORMAT_R8G8B8A8_SRGB = 43,
+	TEXTURE_FORMAT_BC1_RGB_UNORM = 131,
+	TEXTURE_FORMAT_BC1_RGB_SRGB = 132,
+	TEXTURE_FORMAT_BC1_RGBA_UNORM = 133,
+	TEXTURE_FORMAT_BC1_RGBA_SRGB = 134,
+	TEXTURE_FORMAT_BC3_UNORM = 137,
+	TEXTURE_FORMAT_BC3_SRGB = 138,
+	TEXTURE_FORMAT_BC7_UNORM = 145,
+	TEXTURE_FORMAT_BC7_SRGB = 146,
+	TEXTURE_FORMAT_ETC2_R8G8B8_UNORM = 147,
+	TEXTURE_FORMAT_ETC2_R8G8B8_SRGB = 148,
+	TEXTURE_FORMAT_ETC2_R8G8B8A8_UNORM = 151,
+	TEXTURE_FORMAT_ETC2_R8G8B8A8_SRGB = 152,
+	TEXTURE_FORMAT_ASTC_4x4_UNORM = 157,
+	TEXTURE_FORMAT_ASTC_4x4_SRGB = 158
+};
+
+//texels are stored in blocks of blockDim x blockDim, uncompressed formats use 1x1 blocks
+struct TextureFormatInfo
+{
+	uint32_t blockDim;
+	uint32_t blockSize;
+	bool srgb;
+};
+
+//returns false for formats the loader does not know
+inline bool getTextureFormatInfo(uint32_t format, TextureFormatInfo& info)
+{
+	switch(format)
+	{
+		case TEXTURE_FORMAT_R8G8B8A8_UNORM: info = {1, 4, false}; return true;
+		case TEXTURE_FORMAT_R8G8B8A8_SRGB: info = {1, 4, true}; return true;
+		case TEXTURE_FORMAT_BC1_RGB_UNORM:
+		case TEXTURE_FORMAT_BC1_RGBA_UNORM:
+		case TEXTURE_FORMAT_ETC2_R8G8B8_UNORM: info = {4, 8, false}; return true;
+		case TEXTURE_FORMAT_BC1_RGB_SRGB:
+		case TEXTURE_FORMAT_BC1_RGBA_SRGB:
+		case TEXTURE_FORMAT_ETC2_R8G8B8_SRGB: info = {4, 8, true}; return true;
+		case TEXTURE_FORMAT_BC3_UNORM:
+		case TEXTURE_FORMAT_BC7_UNORM:
+		case TEXTURE_FORMAT_ETC2_R8G8B8A8_UNORM:
+		case TEXTURE_FORMAT_ASTC_4x4_UNORM: info = {4, 16, false}; return true;
+		case TEXTURE_FORMAT_BC3_SRGB:
+		case TEXTURE_FORMAT_BC7_SRGB:
+		case TEXTURE_FORMAT_ETC2_R8G8B8A8_SRGB:
+		case TEXTURE_FORMAT_ASTC_4x4_SRGB: info = {4, 16, true}; return true;
+		default: return false;
+	}
+}
+
+//bytes of one mip level as tightly packed rows of blocks
+inline uint64_t textureLevelSize(const TextureFormatInfo& info, uint32_t width, uint32_t height)
+{
+	uint64_t blocksWide = (width + info.blockDim - 1) / info.blockDim;
+	uint64_t blocksHigh = (height + info.blockDim - 1) / info.blockDim;
+	return blocksWide * blocksHigh * info.blockSize;
+}
+
+struct Ktx2Header
+{
+	uint8_t identifier[12];
+	uint32_t vkFormat;
+	uint32_t typeSize;
+	uint32_t pixelWidth;
+	uint32_t pixelHeight;
+	uint32_t pixelDepth;
+	uint32_t layerCount;
+	uint32_t faceCount;
+	uint32_t levelCount;
+	uint32_t supercompressionScheme;
+	uint32_t dfdByteOffset;
+	uint32_t dfdByteLength;
+	uint32_t kvdByteOffset;
+	uint32_t kvdByteLength;
+	uint64_t sgdByteOffset;
+	uint64_t sgdByteLength;
+};
+
+//follows the header, one entry per level with level 0 the largest
+struct Ktx2LevelIndex
+{
+	uint64_t byteOffset;
+	uint64_t byteLength;
+	uint64_t uncompressedByteLength;
+};
+
+//read only view of a KTX2 file, the level pointers stay valid until close()
+//levels are handed to the upload engine directly, nothing is decoded on the way to the staging ring
+class MappedTexture
+{
+	public:
+		MappedTexture() = default;
+		MappedTexture(const MappedTexture&) = delete;
+		MappedTexture& operator=(const MappedTexture&) = delete;
+
+		~MappedTexture()
+		{
+			close();
+		}
+
+		void open(const std::string& path)
+		{
+			close();
+
+			int file = ::open(path.c_str(), O_RDONLY);
+			if(file < 0)
+			{
+				throw std::runtime_error("failed to open texture " + path + "!");
+			}
+
+			struct stat fileStat;
+			if(fstat(file, &fileStat) != 0 || static_cast<uint64_t>(fileStat.st_size) < sizeof(Ktx2Header))
+			{
+				::close(file);
+				throw std::runtime_error("texture " + path + " is too small!");
+			}
+			mappedSize = static_cast<size_t>(fileStat.st_size);
+
+			void* mapping = mmap(nullptr, mappedSize, PROT_READ, MAP_PRIVATE, file, 0);
+			::close(file);
+			if(mapping == MAP_FAILED)
+			{
+				throw std::runtime_error("failed to map texture " + path + "!");
+			}
+			mapped = static_cast<const char*>(mapping);
+			madvise(mapping, mappedSize, MADV_WILLNEED);
+
+			try
+			{
+				validate(path);
+			}
+			catch(...)
+			{
+				close();
+				throw;
+			}
+		}
+
+		void close()
+		{
+			if(mapped != nullptr)
+			{
+				munmap(const_cast<char*>(mapped), mappedSize);
+				mapped = nullptr;
+				mappedSize = 0;
+			}
+		}
+
+		bool isOpen() const
+		{
+			return mapped != nullptr;
+		}
+
+		const Ktx2Header& header() const
+		{
+			return *reinterpret_cast<const Ktx2Header*>(mapped);
+		}
+
+		uint32_t format() const
+		{
+			return header().vkFormat;
+		}
+
+		const TextureFormatInfo& formatInfo() const
+		{
+			return info;
+		}
+
+		uint32_t width() const
+		{
+			return header().pixelWidth;
+		}
+
+		uint32_t height() const
+		{
+			return header().pixelHeight;
+		}
+
+		//a level count of 0 asks the loader to generate mips, only level 0 is stored then
+		//TextureDecoder generates them for rgba8 files, block compressed files are sampled at level 0 only
+		uint32_t levelCount() const
+		{
+			return std::max(header().levelCount, 1u);
+		}
+
+		const void* levelData(uint32_t level) const
+		{
+			return mapped + levels()[level].byteOffset;
+		}
+
+		uint64_t levelSize(uint32_t level) const
+		{
+			return levels()[level].byteLength;
+		}
+
+	private:
+		const char* mapped = nullptr;
+		size_t mappedSize = 0;
+		TextureFormatInfo info = {};
+
+		const Ktx2LevelIndex* levels() const
+		{
+			return reinterpret_cast<const Ktx2LevelIndex*>(mapped + sizeof(Ktx2Header));
+		}
+
+		void validate(const std::string& path)
+		{
+			const Ktx2Header& fileHeader = header();
+			if(memcmp(fileHeader.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0)
+			{
+				throw std::runtime_error(path + " is not a KTX2 file!");
+			}
+			if(!getTextureFormatInfo(fileHeader.vkFormat, info))
+			{
+				throw std::runtime_error("texture " + path + " uses unsupported format " + std::to_string(fileHeader.vkFormat) + "!");
+			}
+			if(fileHeader.pixelWidth == 0 || fileHeader.pixelHeight == 0 || fileHeader.pixelDepth != 0 || fileHeader.layerCount > 1 || fileHeader.faceCount != 1 || fileHeader.supercompressionScheme != 0)
+			{
+				throw std::runtime_error("texture " + path + " is not a plain 2D texture!");
+			}
+
+			uint32_t levelCount = this->levelCount();
+			if(levelCount > 32 || sizeof(Ktx2Header) + levelCount * sizeof(Ktx2LevelIndex) > mappedSize)
+			{
+				throw std::runtime_error("texture " + path + " is truncated or corrupt!");
+			}
+
+			for(uint32_t level = 0; level < levelCount; level++)
+			{
+				const Ktx2LevelIndex& entry = levels()[level];
+				uint64_t expectedSize = textureLevelSize(info, std::max(fileHeader.pixelWidth >> level, 1u), std::max(fileHeader.pixelHeight >> level, 1u));
+				if(entry.byteOffset > mappedSize || entry.byteLength > mappedSize - entry.byteOffset || entry.byteLength != expectedSize)
+				{
+					throw std::runtime_error("texture " + path + " has an invalid level " + std::to_string(level) + "!");
+				}
+			}
+		}
+};
+
+inline bool isBCTextureFormat(uint32_t format)
+{
+	return (format >= TEXTURE_FORMAT_BC1_RGB_UNORM && format <= TEXTURE_FORMAT_BC1_RGBA_SRGB) || format == TEXTURE_FORMAT_BC3_UNORM || format == TEXTURE_FORMAT_BC3_SRGB;
+}
+
+//expands a 5:6:5 colour to rgba8 with full alpha, the rgba8 texels are stored as little endian uint32_t
+inline uint32_t expandRGB565(uint16_t color)
+{
+	uint32_t r = (color >> 11) & 31;
+	uint32_t g = (color >> 5) & 63;
+	uint32_t b = color & 31;
+	r = (r << 3) | (r >> 2);
+	g = (g << 2) | (g >> 4);
+	b = (b << 3) | (b >> 2);
+	return r | (g << 8) | (b << 16) | 0xff000000u;
+}
+
+inline uint32_t lerpRGBA8(uint32_t a, uint32_t b, uint32_t weightA, uint32_t weightB, uint32_t divisor)
+{
+	uint32_t result = 0;
+	for(uint32_t shift = 0; shift < 32; shift += 8)
+	{
+		uint32_t channel = (((a >> shift) & 255) * weightA + ((b >> shift) & 255) * weightB + divisor / 2) / divisor;
+		result |= channel << shift;
+	}
+	return result;
+}
+
+//decodes the 8 byte colour half of a BC1 or BC3 block into 16 texels, BC3 colour blocks always use four colours
+//BC1 blocks with color0 <= color1 use three colours and black, which is transparent only for the RGBA formats
+inline void decodeBC1Block(const uint8_t* block, uint32_t* texels, bool alwaysFourColors, bool allowTransparent)
+{
+	uint16_t color0 = static_cast<uint16_t>(block[0] | (block[1] << 8));
+	uint16_t color1 = static_cast<uint16_t>(block[2] | (block[3] << 8));
+
+	uint32_t palette[4];
+	palette[0] = expandRGB565(color0);
+	palette[1] = expandRGB565(color1);
+	if(color0 > color1 || alwaysFourColors)
+	{
+		palette[2] = lerpRGBA8(palette[0], palette[1], 2, 1, 3);
+		palette[3] = lerpRGBA8(palette[0], palette[1], 1, 2, 3);
+	}
+	else
+	{
+		palette[2] = lerpRGBA8(palette[0], palette[1], 1, 1, 2);
+		palette[3] = allowTransparent ? 0 : 0xff000000u;
+	}
+
+	uint32_t indices = block[4] | (block[5] << 8) | (block[6] << 16) | (static_cast<uint32_t>(block[7]) << 24);
+	for(uint32_t i = 0; i < 16; i++)
+	{
+		texels[i] = palette[(indices >> (i * 2)) & 3];
+	}
+}
+
+//decodes the 8 byte alpha half of a BC3 block into the alpha byte of 16 texels
+inline void decodeBC3AlphaBlock(const uint8_t* block, uint32_t* texels)
+{
+	uint32_t alpha[8];
+	alpha[0] = block[0];
+	alpha[1] = block[1];
+	if(alpha[0] > alpha[1])
+	{
+		for(uint32_t i = 1; i < 7; i++)
+		{
+			alpha[i + 1] = ((7 - i) * alpha[0] + i * alpha[1] + 3) / 7;
+		}
+	}
+	else
+	{
+		for(uint32_t i = 1; i < 5; i++)
+		{
+			alpha[i + 1] = ((5 - i) * alpha[0] + i * alpha[1] + 2) / 5;
+		}
+		alpha[6] = 0;
+		alpha[7] = 255;
+	}
+
+	uint64_t indices = 0;
+	for(uint32_t i = 0; i < 6; i++)
+	{
+		indices |= static_cast<uint64_t>(block[2 + i]) << (i * 8);
+	}
+	for(uint32_t i = 0; i < 16; i++)
+	{
+		texels[i] = (texels[i] & 0x00ffffffu) | (alpha[(indices >> (i * 3)) & 7] << 24);
+	}
+}
+
+//cpu fallback for devices without BC support, returns the level as tightly packed rgba8
+inline std::vector<uint8_t> decompressBCLevel(uint32_t format, const void* data, uint32_t width, uint32_t height)
+{
+	bool bc3 = format == TEXTURE_FORMAT_BC3_UNORM || format == TEXTURE_FORMAT_BC3_SRGB;
+	bool allowTransparent = format == TEXTURE_FORMAT_BC1_RGBA_UNORM || format == TEXTURE_FORMAT_BC1_RGBA_SRGB;
+	uint32_t blockSize = bc3 ? 16 : 8;
+	uint32_t blocksWide = (width + 3) / 4;
+	uint32_t blocksHigh = (height + 3) / 4;
+
+	std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 4);
+	uint32_t* output = reinterpret_cast<uint32_t*>(pixels.data());
+	const uint8_t* block = static_cast<const uint8_t*>(data);
+	for(uint32_t blockY = 0; blockY < blocksHigh; blockY++)
+	{
+		for(uint32_t blockX = 0; blockX < blocksWide; blockX++, block += blockSize)
+		{
+			uint32_t texels[16];
+			if(bc3)
+			{
+				decodeBC1Block(block + 8, texels, true, false);
+				decodeBC3AlphaBlock(block, texels);
+			}
+			else
+			{
+				decodeBC1Block(block, texels, false, allowTransparent);
+			}
+
+			//blocks on the right and bottom edge may hang over the image
+			for(uint32_t y = 0; y < 4 && blockY * 4 + y < height; y++)
+			{
+				for(uint32_t x = 0; x < 4 && blockX * 4 + x < width; x++)
+				{
+					output[static_cast<size_t>(blockY * 4 + y) * width + blockX * 4 + x] = texels[y * 4 + x];
+				}
+			}
+		}
+	}
+	return pixels;
+}
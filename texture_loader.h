@@ -0,0 +1,250 @@
+#pragma once
+
+#include "pch.h"
+
+#include <stb_image.h>
+
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+
+#include "thread_pool.h"
+#include "texture_format.h"
+#include "image_mips.h"
+
+//one texture decoded on a worker, handed to the upload engine on the main thread
+struct DecodedTexture
+{
+	uint32_t id = 0;
+	std::string path;
+	//set instead of the fields below when loading failed
+	std::string error;
+
+	//a TextureFormat value, which is also the VkFormat value
+	uint32_t format = TEXTURE_FORMAT_R8G8B8A8_UNORM;
+	TextureFormatInfo info = {1, 4, false};
+	uint32_t width = 0;
+	uint32_t height = 0;
+	//mip i in the image's format, pointing into ownedLevels, decodedPixels or the mapped file
+	std::vector<const void*> levels;
+	//only mip 0 is present and the rest is to be blitted on the gpu
+	bool generateMips = false;
+	bool decodedOnCpu = false;
+
+	std::vector<std::vector<uint8_t>> ownedLevels;
+	//the image as stb_image decoded it, uploaded without another copy
+	std::unique_ptr<stbi_uc, decltype(&stbi_image_free)> decodedPixels{nullptr, stbi_image_free};
+	std::unique_ptr<MappedTexture> mapping;
+};
+
+struct TextureDecodeSettings
+{
+	//gpu, cpu or off, see --mips
+	std::string mipMode = "gpu";
+	//whether rgba8 can be blitted with linear filtering, otherwise the gpu mip mode builds the chain on the cpu
+	bool canBlitRGBA8 = true;
+	//whether the device can sample a format stored in a KTX2 file, unsupported BC files are decoded
+	std::function<bool(uint32_t format)> formatSupported;
+};
+
+//decodes textures on the worker pool, finished textures are collected in the order they complete
+//jpeg/png decoding and the mip chain run on a worker, KTX2 files are mapped, validated and paged in there
+class TextureDecoder
+{
+	public:
+		void init(ThreadPool* pool, TextureDecodeSettings settings)
+		{
+			this->pool = pool;
+			this->settings = std::move(settings);
+		}
+
+		//queues path for decoding and returns the id its DecodedTexture will carry
+		uint32_t request(const std::string& path)
+		{
+			uint32_t id = nextId++;
+			{
+				std::lock_guard<std::mutex> lock(finishedMutex);
+				pendingCount++;
+			}
+
+			//the future is not needed, results and errors are passed through the finished queue
+			auto job = [this, id, path]()
+			{
+				std::unique_ptr<DecodedTexture> texture(new DecodedTexture());
+				texture->id = id;
+				texture->path = path;
+				try
+				{
+					decode(*texture);
+				}
+				catch(const std::exception& e)
+				{
+					texture->error = e.what();
+				}
+
+				{
+					std::lock_guard<std::mutex> lock(finishedMutex);
+					finished.push_back(std::move(texture));
+					pendingCount--;
+				}
+				finishedCondition.notify_all();
+			};
+
+			//a pool without workers never runs submitted jobs, so on a single core the decode happens right here
+			if(pool->getThreadCount() == 0)
+			{
+				job();
+			}
+			else
+			{
+				pool->submit(job);
+			}
+			return id;
+		}
+
+		//moves every texture finished so far into out without blocking
+		void collect(std::vector<std::unique_ptr<DecodedTexture>>& out)
+		{
+			std::lock_guard<std::mutex> lock(finishedMutex);
+			for(auto& texture : finished)
+			{
+				out.push_back(std::move(texture));
+			}
+			finished.clear();
+		}
+
+		//blocks until every requested texture has been decoded, they are still collected with collect()
+		void waitAll()
+		{
+			std::unique_lock<std::mutex> lock(finishedMutex);
+			finishedCondition.wait(lock, [this]() { return pendingCount == 0; });
+		}
+
+		bool idle()
+		{
+			std::lock_guard<std::mutex> lock(finishedMutex);
+			return pendingCount == 0 && finished.empty();
+		}
+
+	private:
+		ThreadPool* pool = nullptr;
+		TextureDecodeSettings settings;
+		uint32_t nextId = 0;
+
+		std::mutex finishedMutex;
+		std::condition_variable finishedCondition;
+		std::vector<std::unique_ptr<DecodedTexture>> finished;
+		uint32_t pendingCount = 0;
+
+		static bool isKtx2(const std::string& path)
+		{
+			const std::string extension = ".ktx2";
+			return path.size() > extension.size() && path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+		}
+
+		void decode(DecodedTexture& texture)
+		{
+			if(isKtx2(texture.path))
+			{
+				decodeKtx2(texture);
+			}
+			else
+			{
+				decodeImage(texture);
+			}
+		}
+
+		void decodeImage(DecodedTexture& texture)
+		{
+			int texWidth, texHeight, texChannels;
+			stbi_uc* pixles = stbi_load(texture.path.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+			if(!pixles)
+			{
+				throw std::runtime_error("failed to load texture image " + texture.path + "!");
+			}
+
+			texture.width = static_cast<uint32_t>(texWidth);
+			texture.height = static_cast<uint32_t>(texHeight);
+			uint32_t mipLevels = settings.mipMode == "off" ? 1 : mipLevelCount(texture.width, texture.height);
+
+			if(mipLevels > 1 && (settings.mipMode == "cpu" || !settings.canBlitRGBA8))
+			{
+				buildMipChain(texture, pixles, mipLevels);
+				stbi_image_free(pixles);
+				return;
+			}
+
+			texture.decodedPixels.reset(pixles);
+			texture.levels.push_back(pixles);
+			texture.generateMips = mipLevels > 1;
+		}
+
+		//box filters the rgba8 image at pixels into a chain owned by texture
+		void buildMipChain(DecodedTexture& texture, const uint8_t* pixels, uint32_t mipLevels)
+		{
+			texture.ownedLevels.push_back(buildMipChainRGBA8(pixels, texture.width, texture.height));
+			const uint8_t* level = texture.ownedLevels.back().data();
+			for(uint32_t i = 0; i < mipLevels; i++)
+			{
+				texture.levels.push_back(level);
+				level += mipChainSize(std::max(texture.width >> i, 1u), std::max(texture.height >> i, 1u), 1, 4);
+			}
+			texture.decodedOnCpu = true;
+		}
+
+		//the stored levels are uploaded from the mapping, BC files are only decoded when the device cannot sample them
+		//a level count of 0 on an rgba8 file gets its chain generated like a jpeg or png, other formats are sampled at level 0 only
+		void decodeKtx2(DecodedTexture& texture)
+		{
+			texture.mapping.reset(new MappedTexture());
+			MappedTexture& file = *texture.mapping;
+			file.open(texture.path);
+
+			texture.width = file.width();
+			texture.height = file.height();
+			uint32_t mipLevels = settings.mipMode == "off" ? 1 : file.levelCount();
+
+			if(settings.formatSupported(file.format()))
+			{
+				texture.format = file.format();
+				texture.info = file.formatInfo();
+
+				bool rgba8 = file.format() == TEXTURE_FORMAT_R8G8B8A8_UNORM || file.format() == TEXTURE_FORMAT_R8G8B8A8_SRGB;
+				uint32_t generatedLevels = mipLevelCount(texture.width, texture.height);
+				if(file.header().levelCount == 0 && rgba8 && settings.mipMode != "off" && generatedLevels > 1)
+				{
+					if(settings.mipMode == "cpu" || !settings.canBlitRGBA8)
+					{
+						buildMipChain(texture, static_cast<const uint8_t*>(file.levelData(0)), generatedLevels);
+						texture.mapping.reset();
+					}
+					else
+					{
+						texture.levels.push_back(file.levelData(0));
+						texture.generateMips = true;
+					}
+					return;
+				}
+
+				for(uint32_t level = 0; level < mipLevels; level++)
+				{
+					texture.levels.push_back(file.levelData(level));
+				}
+				return;
+			}
+
+			if(!isBCTextureFormat(file.format()))
+			{
+				throw std::runtime_error("texture format " + std::to_string(file.format()) + " of " + texture.path + " is not supported by the device!");
+			}
+
+			texture.format = file.formatInfo().srgb ? TEXTURE_FORMAT_R8G8B8A8_SRGB : TEXTURE_FORMAT_R8G8B8A8_UNORM;
+			for(uint32_t level = 0; level < mipLevels; level++)
+			{
+				texture.ownedLevels.push_back(decompressBCLevel(file.format(), file.levelData(level), std::max(texture.width >> level, 1u), std::max(texture.height >> level, 1u)));
+				texture.levels.push_back(texture.ownedLevels.back().data());
+			}
+			texture.decodedOnCpu = true;
+			texture.mapping.reset();
+		}
+};
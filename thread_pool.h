@@ -0,0 +1,170 @@
+#pragma once
+
+#include "pch.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <future>
+
+//fixed set of worker threads fed from one job queue
+//every job is told which worker runs it so callers can keep per worker resources such as command pools
+class ThreadPool
+{
+	public:
+		//0 uses one thread per core besides the calling thread
+		void init(uint32_t threadCount = 0)
+		{
+			if(threadCount == 0)
+			{
+				threadCount = std::max(1u, std::thread::hardware_concurrency()) - 1;
+			}
+
+			stopping = false;
+			for(uint32_t i = 0; i < threadCount; i++)
+			{
+				threads.emplace_back([this, i]() { workerLoop(i); });
+			}
+		}
+
+		void destroy()
+		{
+			{
+				std::lock_guard<std::mutex> lock(queueMutex);
+				stopping = true;
+			}
+			queueCondition.notify_all();
+
+			for(auto& thread : threads)
+			{
+				thread.join();
+			}
+			threads.clear();
+		}
+
+		uint32_t getThreadCount() const
+		{
+			return static_cast<uint32_t>(threads.size());
+		}
+
+		//number of distinct worker indices parallelFor hands out, the calling thread uses the last one
+		uint32_t getWorkerSlotCount() const
+		{
+			return static_cast<uint32_t>(threads.size()) + 1;
+		}
+
+		template<typename F>
+		auto submit(F&& task) -> std::future<decltype(task())>
+		{
+			typedef decltype(task()) Result;
+			auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+			std::future<Result> future = packaged->get_future();
+
+			enqueue([packaged](uint32_t) { (*packaged)(); });
+			return future;
+		}
+
+		//runs body(task, worker) for every task in [0, taskCount) and returns once all of them finished
+		//the calling thread works through tasks as well instead of sleeping, the first exception thrown is rethrown here
+		void parallelFor(uint32_t taskCount, const std::function<void(uint32_t task, uint32_t worker)>& body)
+		{
+			if(taskCount == 0)
+			{
+				return;
+			}
+
+			//helpers can still be queued after the last task finished, so the state outlives this call
+			auto state = std::make_shared<ParallelForState>();
+			state->body = body;
+			state->taskCount = taskCount;
+
+			uint32_t helperCount = std::min(taskCount - 1, getThreadCount());
+			for(uint32_t i = 0; i < helperCount; i++)
+			{
+				enqueue([state](uint32_t worker) { runTasks(*state, worker); });
+			}
+
+			runTasks(*state, getThreadCount());
+
+			std::unique_lock<std::mutex> lock(state->doneMutex);
+			state->doneCondition.wait(lock, [&state]() { return state->finishedCount == state->taskCount; });
+
+			if(state->exception)
+			{
+				std::rethrow_exception(state->exception);
+			}
+		}
+
+	private:
+		struct ParallelForState
+		{
+			std::function<void(uint32_t, uint32_t)> body;
+			uint32_t taskCount = 0;
+			std::atomic<uint32_t> nextTask{0};
+
+			std::mutex doneMutex;
+			std::condition_variable doneCondition;
+			uint32_t finishedCount = 0;
+			std::exception_ptr exception;
+		};
+
+		std::vector<std::thread> threads;
+
+		std::mutex queueMutex;
+		std::condition_variable queueCondition;
+		std::queue<std::function<void(uint32_t)>> jobs;
+		bool stopping = false;
+
+		void enqueue(std::function<void(uint32_t)> job)
+		{
+			{
+				std::lock_guard<std::mutex> lock(queueMutex);
+				jobs.push(std::move(job));
+			}
+			queueCondition.notify_one();
+		}
+
+		void workerLoop(uint32_t worker)
+		{
+			while(true)
+			{
+				std::function<void(uint32_t)> job;
+				{
+					std::unique_lock<std::mutex> lock(queueMutex);
+					queueCondition.wait(lock, [this]() { return stopping || !jobs.empty(); });
+					if(stopping && jobs.empty())
+					{
+						return;
+					}
+					job = std::move(jobs.front());
+					jobs.pop();
+				}
+				job(worker);
+			}
+		}
+
+		static void runTasks(ParallelForState& state, uint32_t worker)
+		{
+			uint32_t task;
+			while((task = state.nextTask++) < state.taskCount)
+			{
+				try
+				{
+					state.body(task, worker);
+				}
+				catch(...)
+				{
+					std::lock_guard<std::mutex> lock(state.doneMutex);
+					if(!state.exception) state.exception = std::current_exception();
+				}
+
+				std::lock_guard<std::mutex> lock(state.doneMutex);
+				if(++state.finishedCount == state.taskCount)
+				{
+					state.doneCondition.notify_all();
+				}
+			}
+		}
+};
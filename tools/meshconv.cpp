@@ -0,0 +1,590 @@
+//converts a wavefront obj into the binary mesh format read by the renderer
+//usage: meshconv <input.obj> <output.mesh>
+//vertices are deduplicated, every submesh (one per usemtl/o/g) gets its own contiguous vertex range so 16 bit indices
+//can be used per submesh, and the triangles are reordered for the post transform vertex cache and then for overdraw
+
+#include "../mesh_format.h"
+
+#include <sstream>
+#include <cmath>
+#include <unordered_map>
+
+struct ConvertedVertex
+{
+	float pos[3];
+	float color[3];
+	float texCoord[2];
+};
+
+struct ObjSubmesh
+{
+	std::string name;
+	uint32_t materialIndex = 0;
+	std::vector<ConvertedVertex> vertices;
+	std::vector<uint32_t> indices;
+	std::unordered_map<uint64_t, uint32_t> vertexLookup;
+};
+
+static std::vector<ObjSubmesh> parseObj(const std::string& path)
+{
+	std::ifstream file(path);
+	if(!file.is_open())
+	{
+		throw std::runtime_error("failed to open " + path + "!");
+	}
+
+	std::vector<float> positions;
+	std::vector<float> colors;
+	std::vector<float> texCoords;
+	std::vector<std::string> materials;
+	std::vector<ObjSubmesh> submeshes(1);
+
+	//a new submesh starts on every usemtl, o or g that follows faces
+	auto startSubmesh = [&](std::string name, uint32_t materialIndex)
+	{
+		if(!submeshes.back().indices.empty())
+		{
+			submeshes.emplace_back();
+		}
+		submeshes.back().name = std::move(name);
+		submeshes.back().materialIndex = materialIndex;
+	};
+
+	//obj indices are 1 based and negative ones count back from the end
+	auto resolve = [](long index, size_t count) -> long
+	{
+		return index > 0 ? index - 1 : static_cast<long>(count) + index;
+	};
+
+	std::string line;
+	size_t lineNumber = 0;
+	while(std::getline(file, line))
+	{
+		lineNumber++;
+		std::istringstream stream(line);
+		std::string keyword;
+		stream >> keyword;
+
+		if(keyword == "v")
+		{
+			float x = 0.0f, y = 0.0f, z = 0.0f;
+			stream >> x >> y >> z;
+			positions.insert(positions.end(), {x, y, z});
+
+			//common extension storing a vertex colour after the position
+			float r, g, b;
+			if(stream >> r >> g >> b)
+			{
+				colors.insert(colors.end(), {r, g, b});
+			}
+			else
+			{
+				colors.insert(colors.end(), {1.0f, 1.0f, 1.0f});
+			}
+		}
+		else if(keyword == "vt")
+		{
+			float u = 0.0f, v = 0.0f;
+			stream >> u >> v;
+			//obj puts the origin at the bottom left, vulkan samples from the top left
+			texCoords.insert(texCoords.end(), {u, 1.0f - v});
+		}
+		else if(keyword == "usemtl")
+		{
+			std::string name;
+			stream >> name;
+			auto found = std::find(materials.begin(), materials.end(), name);
+			uint32_t materialIndex = static_cast<uint32_t>(found - materials.begin());
+			if(found == materials.end())
+			{
+				materials.push_back(name);
+			}
+			startSubmesh(submeshes.back().name, materialIndex);
+		}
+		else if(keyword == "o" || keyword == "g")
+		{
+			std::string name;
+			stream >> name;
+			startSubmesh(name, submeshes.back().materialIndex);
+		}
+		else if(keyword == "f")
+		{
+			ObjSubmesh& submesh = submeshes.back();
+			std::vector<uint32_t> polygon;
+
+			std::string corner;
+			while(stream >> corner)
+			{
+				long positionIndex = 0;
+				long texCoordIndex = 0;
+				if(sscanf(corner.c_str(), "%ld/%ld", &positionIndex, &texCoordIndex) < 1)
+				{
+					throw std::runtime_error(path + ":" + std::to_string(lineNumber) + ": malformed face");
+				}
+				positionIndex = resolve(positionIndex, positions.size() / 3);
+				texCoordIndex = texCoordIndex != 0 ? resolve(texCoordIndex, texCoords.size() / 2) : -1;
+				if(positionIndex < 0 || static_cast<size_t>(positionIndex) >= positions.size() / 3 || texCoordIndex >= static_cast<long>(texCoords.size() / 2))
+				{
+					throw std::runtime_error(path + ":" + std::to_string(lineNumber) + ": face index out of range");
+				}
+
+				//the same position and texture coordinate pair is only stored once per submesh
+				uint64_t key = (static_cast<uint64_t>(positionIndex) << 32) | static_cast<uint32_t>(texCoordIndex + 1);
+				auto found = submesh.vertexLookup.find(key);
+				if(found == submesh.vertexLookup.end())
+				{
+					ConvertedVertex vertex = {};
+					memcpy(vertex.pos, &positions[positionIndex * 3], sizeof(vertex.pos));
+					memcpy(vertex.color, &colors[positionIndex * 3], sizeof(vertex.color));
+					if(texCoordIndex >= 0)
+					{
+						memcpy(vertex.texCoord, &texCoords[texCoordIndex * 2], sizeof(vertex.texCoord));
+					}
+					found = submesh.vertexLookup.emplace(key, static_cast<uint32_t>(submesh.vertices.size())).first;
+					submesh.vertices.push_back(vertex);
+				}
+				polygon.push_back(found->second);
+			}
+
+			//polygons are triangulated as a fan
+			for(size_t i = 2; i < polygon.size(); i++)
+			{
+				submesh.indices.insert(submesh.indices.end(), {polygon[0], polygon[i - 1], polygon[i]});
+			}
+		}
+	}
+
+	submeshes.erase(std::remove_if(submeshes.begin(), submeshes.end(), [](const ObjSubmesh& submesh) { return submesh.indices.empty(); }), submeshes.end());
+	if(submeshes.empty())
+	{
+		throw std::runtime_error(path + " contains no faces!");
+	}
+	return submeshes;
+}
+
+//average cache misses per triangle for a fifo cache of the given size, 0.5 is the ideal for large regular meshes
+static double averageCacheMissRatio(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize = 16)
+{
+	std::vector<uint32_t> insertedAt(vertexCount, 0);
+	uint32_t time = 0;
+	uint32_t misses = 0;
+	for(uint32_t index : indices)
+	{
+		if(insertedAt[index] == 0 || time - insertedAt[index] >= cacheSize)
+		{
+			insertedAt[index] = ++time;
+			misses++;
+		}
+	}
+	return indices.empty() ? 0.0 : static_cast<double>(misses) / (indices.size() / 3);
+}
+
+//tom forsyth's linear speed vertex cache optimisation, greedily emits the triangle whose vertices score best
+//against a simulated lru cache, favouring recently used vertices and those with few triangles left
+static std::vector<uint32_t> optimizeVertexCache(const std::vector<uint32_t>& indices, uint32_t vertexCount)
+{
+	const int CACHE_SIZE = 32;
+	const float CACHE_DECAY_POWER = 1.5f;
+	const float LAST_TRIANGLE_SCORE = 0.75f;
+	const float VALENCE_BOOST_SCALE = 2.0f;
+	const float VALENCE_BOOST_POWER = 0.5f;
+
+	uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+
+	//triangles using each vertex, as offsets into one flat list
+	std::vector<uint32_t> triangleOffsets(vertexCount + 1, 0);
+	for(uint32_t index : indices)
+	{
+		triangleOffsets[index + 1]++;
+	}
+	for(uint32_t i = 0; i < vertexCount; i++)
+	{
+		triangleOffsets[i + 1] += triangleOffsets[i];
+	}
+	std::vector<uint32_t> vertexTriangles(indices.size());
+	std::vector<uint32_t> remaining(vertexCount, 0);
+	for(uint32_t triangle = 0; triangle < triangleCount; triangle++)
+	{
+		for(uint32_t corner = 0; corner < 3; corner++)
+		{
+			uint32_t vertex = indices[triangle * 3 + corner];
+			vertexTriangles[triangleOffsets[vertex] + remaining[vertex]++] = triangle;
+		}
+	}
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	auto vertexScore = [&](uint32_t vertex) -> float
+	{
+		if(remaining[vertex] == 0)
+		{
+			return -1.0f;
+		}
+		float score = 0.0f;
+		int position = cachePosition[vertex];
+		if(position >= 0)
+		{
+			//the last triangle's vertices get a fixed score so the next triangle does not simply reuse the same edge
+			score = position < 3 ? LAST_TRIANGLE_SCORE : std::pow(1.0f - (position - 3) / static_cast<float>(CACHE_SIZE - 3), CACHE_DECAY_POWER);
+		}
+		return score + VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remaining[vertex]), -VALENCE_BOOST_POWER);
+	};
+
+	std::vector<float> scores(vertexCount);
+	for(uint32_t vertex = 0; vertex < vertexCount; vertex++)
+	{
+		scores[vertex] = vertexScore(vertex);
+	}
+	std::vector<float> triangleScores(triangleCount);
+	for(uint32_t triangle = 0; triangle < triangleCount; triangle++)
+	{
+		triangleScores[triangle] = scores[indices[triangle * 3]] + scores[indices[triangle * 3 + 1]] + scores[indices[triangle * 3 + 2]];
+	}
+
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<uint32_t> output;
+	output.reserve(indices.size());
+	std::vector<uint32_t> cache;
+	std::vector<uint32_t> newCache;
+	uint32_t scanCursor = 0;
+
+	int64_t best = -1;
+	while(output.size() < indices.size())
+	{
+		if(best < 0)
+		{
+			//nothing in the cache is connected to unemitted triangles, restart from the best remaining one
+			float bestScore = -1.0f;
+			for(uint32_t triangle = scanCursor; triangle < triangleCount; triangle++)
+			{
+				if(!emitted[triangle] && triangleScores[triangle] > bestScore)
+				{
+					bestScore = triangleScores[triangle];
+					best = triangle;
+				}
+			}
+		}
+
+		uint32_t triangle = static_cast<uint32_t>(best);
+		emitted[triangle] = true;
+		while(scanCursor < triangleCount && emitted[scanCursor])
+		{
+			scanCursor++;
+		}
+
+		newCache.clear();
+		for(uint32_t corner = 0; corner < 3; corner++)
+		{
+			uint32_t vertex = indices[triangle * 3 + corner];
+			output.push_back(vertex);
+			newCache.push_back(vertex);
+
+			//unlink the triangle from the vertex
+			uint32_t* first = &vertexTriangles[triangleOffsets[vertex]];
+			uint32_t* last = first + remaining[vertex];
+			*std::find(first, last, triangle) = *(last - 1);
+			remaining[vertex]--;
+		}
+		for(uint32_t vertex : cache)
+		{
+			if(std::find(newCache.begin(), newCache.end(), vertex) == newCache.end())
+			{
+				newCache.push_back(vertex);
+			}
+		}
+
+		//rescore everything that was or is in the cache, only their triangles can change score
+		for(size_t i = 0; i < newCache.size(); i++)
+		{
+			cachePosition[newCache[i]] = i < static_cast<size_t>(CACHE_SIZE) ? static_cast<int>(i) : -1;
+		}
+		best = -1;
+		float bestScore = -1.0f;
+		for(uint32_t vertex : newCache)
+		{
+			float previous = scores[vertex];
+			scores[vertex] = vertexScore(vertex);
+			float change = scores[vertex] - previous;
+
+			for(uint32_t i = 0; i < remaining[vertex]; i++)
+			{
+				uint32_t neighbour = vertexTriangles[triangleOffsets[vertex] + i];
+				triangleScores[neighbour] += change;
+				if(cachePosition[vertex] >= 0 && triangleScores[neighbour] > bestScore)
+				{
+					bestScore = triangleScores[neighbour];
+					best = neighbour;
+				}
+			}
+		}
+
+		if(newCache.size() > static_cast<size_t>(CACHE_SIZE))
+		{
+			newCache.resize(CACHE_SIZE);
+		}
+		std::swap(cache, newCache);
+	}
+
+	return output;
+}
+
+//splits the cache optimised order into clusters at the points where the cache starts over and sorts them so outward
+//facing clusters come first, they tend to occlude the rest, after sander et al. "fast triangle reordering for vertex locality and reduced overdraw"
+static std::vector<uint32_t> optimizeOverdraw(const std::vector<uint32_t>& indices, const std::vector<ConvertedVertex>& vertices)
+{
+	const uint32_t CACHE_SIZE = 16;
+	uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+
+	std::vector<uint32_t> clusterStarts;
+	std::vector<uint32_t> insertedAt(vertices.size(), 0);
+	uint32_t time = 0;
+	for(uint32_t triangle = 0; triangle < triangleCount; triangle++)
+	{
+		uint32_t misses = 0;
+		for(uint32_t corner = 0; corner < 3; corner++)
+		{
+			uint32_t vertex = indices[triangle * 3 + corner];
+			if(insertedAt[vertex] == 0 || time - insertedAt[vertex] >= CACHE_SIZE)
+			{
+				insertedAt[vertex] = ++time;
+				misses++;
+			}
+		}
+		if(misses == 3)
+		{
+			clusterStarts.push_back(triangle);
+		}
+	}
+	clusterStarts.push_back(triangleCount);
+
+	auto position = [&](uint32_t index)
+	{
+		const float* pos = vertices[index].pos;
+		return std::array<double, 3>{pos[0], pos[1], pos[2]};
+	};
+
+	std::array<double, 3> meshCentroid = {0.0, 0.0, 0.0};
+	for(const ConvertedVertex& vertex : vertices)
+	{
+		for(int axis = 0; axis < 3; axis++)
+		{
+			meshCentroid[axis] += vertex.pos[axis] / vertices.size();
+		}
+	}
+
+	struct Cluster
+	{
+		uint32_t first;
+		uint32_t end;
+		double sortKey;
+	};
+	std::vector<Cluster> clusters;
+	for(size_t i = 0; i + 1 < clusterStarts.size(); i++)
+	{
+		//area weighted normal and centroid of the cluster
+		std::array<double, 3> normal = {0.0, 0.0, 0.0};
+		std::array<double, 3> centroid = {0.0, 0.0, 0.0};
+		double area = 0.0;
+		for(uint32_t triangle = clusterStarts[i]; triangle < clusterStarts[i + 1]; triangle++)
+		{
+			auto a = position(indices[triangle * 3]);
+			auto b = position(indices[triangle * 3 + 1]);
+			auto c = position(indices[triangle * 3 + 2]);
+			std::array<double, 3> ab = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+			std::array<double, 3> ac = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+			std::array<double, 3> cross = {ab[1] * ac[2] - ab[2] * ac[1], ab[2] * ac[0] - ab[0] * ac[2], ab[0] * ac[1] - ab[1] * ac[0]};
+			double triangleArea = std::sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]);
+			for(int axis = 0; axis < 3; axis++)
+			{
+				normal[axis] += cross[axis];
+				centroid[axis] += (a[axis] + b[axis] + c[axis]) / 3.0 * triangleArea;
+			}
+			area += triangleArea;
+		}
+
+		double sortKey = 0.0;
+		double normalLength = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		if(area > 0.0 && normalLength > 0.0)
+		{
+			for(int axis = 0; axis < 3; axis++)
+			{
+				sortKey += (centroid[axis] / area - meshCentroid[axis]) * normal[axis] / normalLength;
+			}
+		}
+		clusters.push_back({clusterStarts[i], clusterStarts[i + 1], sortKey});
+	}
+
+	std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) { return a.sortKey > b.sortKey; });
+
+	std::vector<uint32_t> output;
+	output.reserve(indices.size());
+	for(const Cluster& cluster : clusters)
+	{
+		output.insert(output.end(), indices.begin() + cluster.first * 3, indices.begin() + cluster.end * 3);
+	}
+	return output;
+}
+
+//renumbers vertices in the order the indices first use them so vertex fetches walk memory forwards
+static void optimizeVertexFetch(std::vector<uint32_t>& indices, std::vector<ConvertedVertex>& vertices)
+{
+	std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+	std::vector<ConvertedVertex> reordered;
+	reordered.reserve(vertices.size());
+	for(uint32_t& index : indices)
+	{
+		if(remap[index] == UINT32_MAX)
+		{
+			remap[index] = static_cast<uint32_t>(reordered.size());
+			reordered.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+	vertices = std::move(reordered);
+}
+
+static void writeMesh(const std::string& path, const std::vector<ObjSubmesh>& submeshes)
+{
+	MeshFileHeader header = {};
+	memcpy(header.magic, MESH_FILE_MAGIC, sizeof(MESH_FILE_MAGIC));
+	header.version = MESH_FILE_VERSION;
+	header.vertexStride = sizeof(ConvertedVertex);
+
+	std::vector<MeshAttribute> attributes = {
+		{MESH_SEMANTIC_POSITION, MESH_FORMAT_FLOAT3, offsetof(ConvertedVertex, pos), 0},
+		{MESH_SEMANTIC_COLOR, MESH_FORMAT_FLOAT3, offsetof(ConvertedVertex, color), 0},
+		{MESH_SEMANTIC_TEXCOORD, MESH_FORMAT_FLOAT2, offsetof(ConvertedVertex, texCoord), 0}
+	};
+	header.attributeCount = static_cast<uint32_t>(attributes.size());
+
+	//16 bit indices whenever every submesh's vertex range fits, they are relative to the submesh's vertexOffset
+	header.indexSize = 2;
+	for(const ObjSubmesh& submesh : submeshes)
+	{
+		if(submesh.vertices.size() > 0xFFFF)
+		{
+			header.indexSize = 4;
+		}
+	}
+
+	std::vector<MeshSubmesh> submeshTable;
+	for(int axis = 0; axis < 3; axis++)
+	{
+		header.boundsMin[axis] = INFINITY;
+		header.boundsMax[axis] = -INFINITY;
+	}
+	for(const ObjSubmesh& submesh : submeshes)
+	{
+		MeshSubmesh entry = {};
+		entry.firstIndex = header.indexCount;
+		entry.indexCount = static_cast<uint32_t>(submesh.indices.size());
+		entry.vertexOffset = static_cast<int32_t>(header.vertexCount);
+		entry.materialIndex = submesh.materialIndex;
+		for(int axis = 0; axis < 3; axis++)
+		{
+			entry.boundsMin[axis] = INFINITY;
+			entry.boundsMax[axis] = -INFINITY;
+		}
+		for(const ConvertedVertex& vertex : submesh.vertices)
+		{
+			for(int axis = 0; axis < 3; axis++)
+			{
+				entry.boundsMin[axis] = std::min(entry.boundsMin[axis], vertex.pos[axis]);
+				entry.boundsMax[axis] = std::max(entry.boundsMax[axis], vertex.pos[axis]);
+			}
+		}
+		for(int axis = 0; axis < 3; axis++)
+		{
+			header.boundsMin[axis] = std::min(header.boundsMin[axis], entry.boundsMin[axis]);
+			header.boundsMax[axis] = std::max(header.boundsMax[axis], entry.boundsMax[axis]);
+		}
+
+		header.indexCount += entry.indexCount;
+		header.vertexCount += static_cast<uint32_t>(submesh.vertices.size());
+		submeshTable.push_back(entry);
+	}
+	header.submeshCount = static_cast<uint32_t>(submeshTable.size());
+
+	header.attributesOffset = alignMeshSection(sizeof(MeshFileHeader));
+	header.submeshesOffset = alignMeshSection(header.attributesOffset + attributes.size() * sizeof(MeshAttribute));
+	header.vertexDataOffset = alignMeshSection(header.submeshesOffset + submeshTable.size() * sizeof(MeshSubmesh));
+	header.vertexDataSize = static_cast<uint64_t>(header.vertexCount) * header.vertexStride;
+	header.indexDataOffset = alignMeshSection(header.vertexDataOffset + header.vertexDataSize);
+	header.indexDataSize = static_cast<uint64_t>(header.indexCount) * header.indexSize;
+
+	std::ofstream file(path, std::ios::binary);
+	if(!file.is_open())
+	{
+		throw std::runtime_error("failed to open " + path + "!");
+	}
+	auto padTo = [&file](uint64_t offset)
+	{
+		static const char zeros[MESH_SECTION_ALIGNMENT] = {};
+		file.write(zeros, static_cast<std::streamsize>(offset - static_cast<uint64_t>(file.tellp())));
+	};
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	padTo(header.attributesOffset);
+	file.write(reinterpret_cast<const char*>(attributes.data()), attributes.size() * sizeof(MeshAttribute));
+	padTo(header.submeshesOffset);
+	file.write(reinterpret_cast<const char*>(submeshTable.data()), submeshTable.size() * sizeof(MeshSubmesh));
+	padTo(header.vertexDataOffset);
+	for(const ObjSubmesh& submesh : submeshes)
+	{
+		file.write(reinterpret_cast<const char*>(submesh.vertices.data()), submesh.vertices.size() * sizeof(ConvertedVertex));
+	}
+	padTo(header.indexDataOffset);
+	for(const ObjSubmesh& submesh : submeshes)
+	{
+		if(header.indexSize == 2)
+		{
+			std::vector<uint16_t> narrow(submesh.indices.begin(), submesh.indices.end());
+			file.write(reinterpret_cast<const char*>(narrow.data()), narrow.size() * sizeof(uint16_t));
+		}
+		else
+		{
+			file.write(reinterpret_cast<const char*>(submesh.indices.data()), submesh.indices.size() * sizeof(uint32_t));
+		}
+	}
+
+	if(!file)
+	{
+		throw std::runtime_error("failed to write " + path + "!");
+	}
+	std::cout << path << ": " << header.vertexCount << " vertices, " << header.indexCount / 3 << " triangles, " << header.submeshCount << " submeshes, " << header.indexSize * 8 << " bit indices\n";
+}
+
+int main(int argc, char* argv[])
+{
+	if(argc != 3)
+	{
+		std::cerr << "usage: meshconv <input.obj> <output.mesh>\n";
+		return EXIT_FAILURE;
+	}
+
+	try
+	{
+		std::vector<ObjSubmesh> submeshes = parseObj(argv[1]);
+
+		for(ObjSubmesh& submesh : submeshes)
+		{
+			uint32_t vertexCount = static_cast<uint32_t>(submesh.vertices.size());
+			double before = averageCacheMissRatio(submesh.indices, vertexCount);
+
+			submesh.indices = optimizeVertexCache(submesh.indices, vertexCount);
+			submesh.indices = optimizeOverdraw(submesh.indices, submesh.vertices);
+			optimizeVertexFetch(submesh.indices, submesh.vertices);
+
+			double after = averageCacheMissRatio(submesh.indices, static_cast<uint32_t>(submesh.vertices.size()));
+			std::cout << "submesh " << (submesh.name.empty() ? "(unnamed)" : submesh.name) << ": " << submesh.indices.size() / 3 << " triangles, acmr " << before << " -> " << after << "\n";
+		}
+
+		writeMesh(argv[2], submeshes);
+	}
+	catch(const std::exception& e)
+	{
+		std::cerr << e.what() << '\n';
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
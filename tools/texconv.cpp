@@ -0,0 +1,434 @@
+//converts an image stb_image can read into a KTX2 texture with a full mip chain in a block compressed format
+//usage: texconv <input image> <output.ktx2> [bc1|bc3|rgba8] [--srgb]
+//without a format bc1 is used for opaque images and bc3 when any texel has alpha, the mips are box filtered before encoding
+
+#include "../texture_format.h"
+#include "../image_mips.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <cmath>
+
+//khronos data format descriptor values used in the basic descriptor block
+const uint32_t KHR_DF_MODEL_RGBSDA = 1;
+const uint32_t KHR_DF_MODEL_BC1A = 128;
+const uint32_t KHR_DF_MODEL_BC3 = 130;
+const uint32_t KHR_DF_PRIMARIES_BT709 = 1;
+const uint32_t KHR_DF_TRANSFER_LINEAR = 1;
+const uint32_t KHR_DF_TRANSFER_SRGB = 2;
+const uint32_t KHR_DF_CHANNEL_COLOR = 0;
+const uint32_t KHR_DF_CHANNEL_ALPHA = 15;
+
+struct TexelBlock
+{
+	//rgba per texel, edge blocks repeat the last row and column
+	uint8_t texels[16][4];
+};
+
+static TexelBlock fetchBlock(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY)
+{
+	TexelBlock block;
+	for(uint32_t y = 0; y < 4; y++)
+	{
+		for(uint32_t x = 0; x < 4; x++)
+		{
+			uint32_t sourceX = std::min(blockX * 4 + x, width - 1);
+			uint32_t sourceY = std::min(blockY * 4 + y, height - 1);
+			memcpy(block.texels[y * 4 + x], pixels + (static_cast<size_t>(sourceY) * width + sourceX) * 4, 4);
+		}
+	}
+	return block;
+}
+
+static uint16_t packRGB565(const float color[3])
+{
+	uint32_t r = static_cast<uint32_t>(std::lround(std::min(std::max(color[0], 0.0f), 255.0f) * 31.0f / 255.0f));
+	uint32_t g = static_cast<uint32_t>(std::lround(std::min(std::max(color[1], 0.0f), 255.0f) * 63.0f / 255.0f));
+	uint32_t b = static_cast<uint32_t>(std::lround(std::min(std::max(color[2], 0.0f), 255.0f) * 31.0f / 255.0f));
+	return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+static uint32_t colorDistance(uint32_t a, const uint8_t* b)
+{
+	int dr = static_cast<int>(a & 255) - b[0];
+	int dg = static_cast<int>((a >> 8) & 255) - b[1];
+	int db = static_cast<int>((a >> 16) & 255) - b[2];
+	return static_cast<uint32_t>(dr * dr + dg * dg + db * db);
+}
+
+//four colour BC1 block, the endpoints are the extremes along the principal axis of the block's colours pulled in by 1/16 of the range
+static void encodeBC1Block(const TexelBlock& block, uint8_t* output)
+{
+	float mean[3] = {};
+	for(const auto& texel : block.texels)
+	{
+		for(int c = 0; c < 3; c++)
+		{
+			mean[c] += texel[c] / 16.0f;
+		}
+	}
+
+	float covariance[6] = {};
+	for(const auto& texel : block.texels)
+	{
+		float d[3] = {texel[0] - mean[0], texel[1] - mean[1], texel[2] - mean[2]};
+		covariance[0] += d[0] * d[0];
+		covariance[1] += d[0] * d[1];
+		covariance[2] += d[0] * d[2];
+		covariance[3] += d[1] * d[1];
+		covariance[4] += d[1] * d[2];
+		covariance[5] += d[2] * d[2];
+	}
+
+	//a few power iterations are enough to find the dominant direction
+	float axis[3] = {1.0f, 1.0f, 1.0f};
+	for(int iteration = 0; iteration < 8; iteration++)
+	{
+		float next[3] = {
+			covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2],
+			covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2],
+			covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2]};
+		float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+		if(length < 1e-6f)
+		{
+			break;
+		}
+		for(int c = 0; c < 3; c++)
+		{
+			axis[c] = next[c] / length;
+		}
+	}
+
+	float minProjection = INFINITY;
+	float maxProjection = -INFINITY;
+	for(const auto& texel : block.texels)
+	{
+		float projection = (texel[0] - mean[0]) * axis[0] + (texel[1] - mean[1]) * axis[1] + (texel[2] - mean[2]) * axis[2];
+		minProjection = std::min(minProjection, projection);
+		maxProjection = std::max(maxProjection, projection);
+	}
+	float inset = (maxProjection - minProjection) / 16.0f;
+	minProjection += inset;
+	maxProjection -= inset;
+
+	float high[3], low[3];
+	for(int c = 0; c < 3; c++)
+	{
+		high[c] = mean[c] + axis[c] * maxProjection;
+		low[c] = mean[c] + axis[c] * minProjection;
+	}
+	uint16_t color0 = packRGB565(high);
+	uint16_t color1 = packRGB565(low);
+
+	//color0 > color1 selects the four colour mode, equal endpoints only use index 0
+	if(color0 < color1)
+	{
+		std::swap(color0, color1);
+	}
+
+	uint32_t palette[4];
+	palette[0] = expandRGB565(color0);
+	palette[1] = expandRGB565(color1);
+	palette[2] = lerpRGBA8(palette[0], palette[1], 2, 1, 3);
+	palette[3] = lerpRGBA8(palette[0], palette[1], 1, 2, 3);
+
+	uint32_t indices = 0;
+	if(color0 != color1)
+	{
+		for(uint32_t i = 0; i < 16; i++)
+		{
+			uint32_t best = 0;
+			uint32_t bestDistance = UINT32_MAX;
+			for(uint32_t candidate = 0; candidate < 4; candidate++)
+			{
+				uint32_t distance = colorDistance(palette[candidate], block.texels[i]);
+				if(distance < bestDistance)
+				{
+					best = candidate;
+					bestDistance = distance;
+				}
+			}
+			indices |= best << (i * 2);
+		}
+	}
+
+	output[0] = static_cast<uint8_t>(color0 & 255);
+	output[1] = static_cast<uint8_t>(color0 >> 8);
+	output[2] = static_cast<uint8_t>(color1 & 255);
+	output[3] = static_cast<uint8_t>(color1 >> 8);
+	for(uint32_t i = 0; i < 4; i++)
+	{
+		output[4 + i] = static_cast<uint8_t>(indices >> (i * 8));
+	}
+}
+
+//eight value BC3 alpha block spanning the block's alpha range
+static void encodeBC3AlphaBlock(const TexelBlock& block, uint8_t* output)
+{
+	uint32_t high = 0;
+	uint32_t low = 255;
+	for(const auto& texel : block.texels)
+	{
+		high = std::max<uint32_t>(high, texel[3]);
+		low = std::min<uint32_t>(low, texel[3]);
+	}
+
+	uint64_t indices = 0;
+	if(high != low)
+	{
+		uint32_t alpha[8] = {high, low};
+		for(uint32_t i = 1; i < 7; i++)
+		{
+			alpha[i + 1] = ((7 - i) * high + i * low + 3) / 7;
+		}
+
+		for(uint32_t i = 0; i < 16; i++)
+		{
+			uint32_t best = 0;
+			uint32_t bestDistance = UINT32_MAX;
+			for(uint32_t candidate = 0; candidate < 8; candidate++)
+			{
+				uint32_t distance = static_cast<uint32_t>(std::abs(static_cast<int>(alpha[candidate]) - block.texels[i][3]));
+				if(distance < bestDistance)
+				{
+					best = candidate;
+					bestDistance = distance;
+				}
+			}
+			indices |= static_cast<uint64_t>(best) << (i * 3);
+		}
+	}
+
+	output[0] = static_cast<uint8_t>(high);
+	output[1] = static_cast<uint8_t>(low);
+	for(uint32_t i = 0; i < 6; i++)
+	{
+		output[2 + i] = static_cast<uint8_t>(indices >> (i * 8));
+	}
+}
+
+static std::vector<uint8_t> encodeLevel(uint32_t format, const uint8_t* pixels, uint32_t width, uint32_t height)
+{
+	TextureFormatInfo info;
+	getTextureFormatInfo(format, info);
+	if(info.blockDim == 1)
+	{
+		return std::vector<uint8_t>(pixels, pixels + static_cast<size_t>(width) * height * 4);
+	}
+
+	bool bc3 = format == TEXTURE_FORMAT_BC3_UNORM || format == TEXTURE_FORMAT_BC3_SRGB;
+	std::vector<uint8_t> encoded(static_cast<size_t>(textureLevelSize(info, width, height)));
+	uint8_t* output = encoded.data();
+	for(uint32_t blockY = 0; blockY < (height + 3) / 4; blockY++)
+	{
+		for(uint32_t blockX = 0; blockX < (width + 3) / 4; blockX++, output += info.blockSize)
+		{
+			TexelBlock block = fetchBlock(pixels, width, height, blockX, blockY);
+			if(bc3)
+			{
+				encodeBC3AlphaBlock(block, output);
+				encodeBC1Block(block, output + 8);
+			}
+			else
+			{
+				encodeBC1Block(block, output);
+			}
+		}
+	}
+	return encoded;
+}
+
+//basic descriptor block, a single sample per channel for rgba8 and one sample per 64 bit half for the BC formats
+static std::vector<uint32_t> buildDataFormatDescriptor(uint32_t format, const TextureFormatInfo& info)
+{
+	struct Sample
+	{
+		uint32_t bitOffset;
+		uint32_t bitLength;
+		uint32_t channel;
+		uint32_t upper;
+	};
+	std::vector<Sample> samples;
+	uint32_t model;
+	if(format == TEXTURE_FORMAT_R8G8B8A8_UNORM || format == TEXTURE_FORMAT_R8G8B8A8_SRGB)
+	{
+		model = KHR_DF_MODEL_RGBSDA;
+		samples = {{0, 8, 0, 255}, {8, 8, 1, 255}, {16, 8, 2, 255}, {24, 8, KHR_DF_CHANNEL_ALPHA, 255}};
+	}
+	else if(format == TEXTURE_FORMAT_BC3_UNORM || format == TEXTURE_FORMAT_BC3_SRGB)
+	{
+		model = KHR_DF_MODEL_BC3;
+		samples = {{0, 64, KHR_DF_CHANNEL_ALPHA, UINT32_MAX}, {64, 64, KHR_DF_CHANNEL_COLOR, UINT32_MAX}};
+	}
+	else
+	{
+		model = KHR_DF_MODEL_BC1A;
+		samples = {{0, 64, KHR_DF_CHANNEL_COLOR, UINT32_MAX}};
+	}
+
+	uint32_t blockSize = 24 + 16 * static_cast<uint32_t>(samples.size());
+	uint32_t dimension = info.blockDim - 1;
+	std::vector<uint32_t> words;
+	words.push_back(4 + blockSize); //total size including this word
+	words.push_back(0); //vendor khronos, descriptor type basic
+	words.push_back(2 | (blockSize << 16)); //version 1.3
+	words.push_back(model | (KHR_DF_PRIMARIES_BT709 << 8) | ((info.srgb ? KHR_DF_TRANSFER_SRGB : KHR_DF_TRANSFER_LINEAR) << 16));
+	words.push_back(dimension | (dimension << 8));
+	words.push_back(info.blockSize);
+	words.push_back(0);
+	for(const Sample& sample : samples)
+	{
+		//the alpha channel of an srgb format stays linear
+		uint32_t qualifiers = info.srgb && sample.channel == KHR_DF_CHANNEL_ALPHA ? 0x10 : 0;
+		words.push_back(sample.bitOffset | ((sample.bitLength - 1) << 16) | ((sample.channel | qualifiers) << 24));
+		words.push_back(0);
+		words.push_back(0);
+		words.push_back(sample.upper);
+	}
+	return words;
+}
+
+static void writeKtx2(const std::string& path, uint32_t format, uint32_t width, uint32_t height, const std::vector<std::vector<uint8_t>>& levels)
+{
+	TextureFormatInfo info;
+	getTextureFormatInfo(format, info);
+	std::vector<uint32_t> dfd = buildDataFormatDescriptor(format, info);
+
+	Ktx2Header header = {};
+	memcpy(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+	header.vkFormat = format;
+	header.typeSize = 1;
+	header.pixelWidth = width;
+	header.pixelHeight = height;
+	header.faceCount = 1;
+	header.levelCount = static_cast<uint32_t>(levels.size());
+	header.dfdByteOffset = static_cast<uint32_t>(sizeof(Ktx2Header) + levels.size() * sizeof(Ktx2LevelIndex));
+	header.dfdByteLength = static_cast<uint32_t>(dfd.size() * sizeof(uint32_t));
+
+	//the spec stores the smallest level first, every level aligned to the block size
+	std::vector<Ktx2LevelIndex> levelIndex(levels.size());
+	uint64_t offset = header.dfdByteOffset + header.dfdByteLength;
+	for(size_t level = levels.size(); level-- > 0;)
+	{
+		offset = (offset + info.blockSize - 1) / info.blockSize * info.blockSize;
+		levelIndex[level].byteOffset = offset;
+		levelIndex[level].byteLength = levels[level].size();
+		levelIndex[level].uncompressedByteLength = levels[level].size();
+		offset += levels[level].size();
+	}
+
+	std::ofstream file(path, std::ios::binary);
+	if(!file.is_open())
+	{
+		throw std::runtime_error("failed to open " + path + "!");
+	}
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(levelIndex.data()), levelIndex.size() * sizeof(Ktx2LevelIndex));
+	file.write(reinterpret_cast<const char*>(dfd.data()), dfd.size() * sizeof(uint32_t));
+	for(size_t level = levels.size(); level-- > 0;)
+	{
+		static const char zeros[16] = {};
+		file.write(zeros, static_cast<std::streamsize>(levelIndex[level].byteOffset - static_cast<uint64_t>(file.tellp())));
+		file.write(reinterpret_cast<const char*>(levels[level].data()), levels[level].size());
+	}
+
+	if(!file)
+	{
+		throw std::runtime_error("failed to write " + path + "!");
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if(argc < 3)
+	{
+		std::cerr << "usage: texconv <input image> <output.ktx2> [bc1|bc3|rgba8] [--srgb]\n";
+		return EXIT_FAILURE;
+	}
+
+	try
+	{
+		std::string formatName;
+		bool srgb = false;
+		for(int i = 3; i < argc; i++)
+		{
+			std::string arg = argv[i];
+			if(arg == "--srgb")
+			{
+				srgb = true;
+			}
+			else if(arg == "bc1" || arg == "bc3" || arg == "rgba8")
+			{
+				formatName = arg;
+			}
+			else
+			{
+				throw std::runtime_error("unknown option " + arg);
+			}
+		}
+
+		int texWidth, texHeight, texChannels;
+		stbi_uc* pixels = stbi_load(argv[1], &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+		if(!pixels)
+		{
+			throw std::runtime_error(std::string("failed to load ") + argv[1] + "!");
+		}
+		uint32_t width = static_cast<uint32_t>(texWidth);
+		uint32_t height = static_cast<uint32_t>(texHeight);
+
+		std::vector<uint8_t> chain = buildMipChainRGBA8(pixels, width, height);
+		stbi_image_free(pixels);
+
+		if(formatName.empty())
+		{
+			bool opaque = true;
+			for(size_t i = 3; i < static_cast<size_t>(width) * height * 4 && opaque; i += 4)
+			{
+				opaque = chain[i] == 255;
+			}
+			formatName = opaque ? "bc1" : "bc3";
+		}
+
+		uint32_t format;
+		if(formatName == "bc1")
+		{
+			format = srgb ? TEXTURE_FORMAT_BC1_RGB_SRGB : TEXTURE_FORMAT_BC1_RGB_UNORM;
+		}
+		else if(formatName == "bc3")
+		{
+			format = srgb ? TEXTURE_FORMAT_BC3_SRGB : TEXTURE_FORMAT_BC3_UNORM;
+		}
+		else
+		{
+			format = srgb ? TEXTURE_FORMAT_R8G8B8A8_SRGB : TEXTURE_FORMAT_R8G8B8A8_UNORM;
+		}
+
+		uint32_t mipLevels = mipLevelCount(width, height);
+		std::vector<std::vector<uint8_t>> levels;
+		const uint8_t* level = chain.data();
+		for(uint32_t i = 0; i < mipLevels; i++)
+		{
+			uint32_t levelWidth = std::max(width >> i, 1u);
+			uint32_t levelHeight = std::max(height >> i, 1u);
+			levels.push_back(encodeLevel(format, level, levelWidth, levelHeight));
+			level += static_cast<size_t>(levelWidth) * levelHeight * 4;
+		}
+
+		writeKtx2(argv[2], format, width, height, levels);
+
+		size_t encodedSize = 0;
+		for(const auto& encoded : levels)
+		{
+			encodedSize += encoded.size();
+		}
+		std::cout << argv[2] << ": " << width << "x" << height << " " << formatName << (srgb ? " srgb" : "") << ", " << mipLevels << " mip levels, " << encodedSize << " bytes (" << chain.size() << " as rgba8)\n";
+	}
+	catch(const std::exception& e)
+	{
+		std::cerr << e.what() << '\n';
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,819 @@
+#pragma once
+
+#include "pch.h"
+
+#include <vulkan/vulkan.h>
+
+#include <functional>
+#include <deque>
+
+#include "memory_allocator.h"
+
+//identifies one submitted batch of uploads, batches complete in ticket order
+typedef uint64_t UploadTicket;
+
+struct UploadEngineStats
+{
+	uint64_t batchCount = 0;
+	uint64_t bufferUploadCount = 0;
+	uint64_t imageUploadCount = 0;
+	uint64_t mipLevelsGenerated = 0; //levels filled by blits on the graphics queue
+	VkDeviceSize bytesUploaded = 0;
+	uint64_t blockingWaitCount = 0;
+	uint64_t chunkCount = 0;
+	uint64_t ringStallCount = 0; //waits for the gpu because the staging ring was full
+	VkDeviceSize peakRingBytesInUse = 0;
+};
+
+//records copies and layout transitions into one command buffer per batch instead of one submit and queue idle per copy
+//a batch is submitted with a fence by flush() and identified by its ticket, staging memory is released once the fence signals
+//staging memory comes from one persistently mapped ring, uploads larger than half of it are split into chunks
+//when a transfer only queue family exists the copies run on it and ownership is handed to the graphics family through release/acquire barriers
+class UploadEngine
+{
+	public:
+		static const VkDeviceSize DEFAULT_RING_SIZE = 16ull * 1024 * 1024;
+		//covers every texel and compressed block size and the 4 byte rule for buffer to image copies
+		static const VkDeviceSize RING_ALIGNMENT = 16;
+
+		void init(VkDevice device, MemoryAllocator* allocator, uint32_t graphicsFamily, VkQueue graphicsQueue, uint32_t transferFamily, VkQueue transferQueue, VkDeviceSize ringSize = DEFAULT_RING_SIZE)
+		{
+			this->device = device;
+			this->allocator = allocator;
+			this->graphicsFamily = graphicsFamily;
+			this->graphicsQueue = graphicsQueue;
+			this->transferFamily = transferFamily;
+			this->transferQueue = transferQueue;
+			dedicatedTransfer = transferFamily != graphicsFamily;
+
+			VkCommandPoolCreateInfo poolInfo = {};
+			poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+			poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+			poolInfo.queueFamilyIndex = graphicsFamily;
+			if(vkCreateCommandPool(device, &poolInfo, nullptr, &graphicsPool) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create upload command pool!");
+			}
+
+			if(dedicatedTransfer)
+			{
+				poolInfo.queueFamilyIndex = transferFamily;
+				if(vkCreateCommandPool(device, &poolInfo, nullptr, &transferPool) != VK_SUCCESS)
+				{
+					throw std::runtime_error("failed to create upload command pool!");
+				}
+			}
+			else
+			{
+				transferPool = graphicsPool;
+			}
+
+			VkBufferCreateInfo bufferInfo = {};
+			bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+			bufferInfo.size = ringSize;
+			bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+			bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+			if(vkCreateBuffer(device, &bufferInfo, nullptr, &ringBuffer) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create staging ring buffer!");
+			}
+
+			VkMemoryRequirements memRequirements;
+			vkGetBufferMemoryRequirements(device, ringBuffer, &memRequirements);
+
+			ringAllocation = allocator->allocate(memRequirements, allocator->findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT), true);
+			vkBindBufferMemory(device, ringBuffer, ringAllocation.memory, ringAllocation.offset);
+
+			ringCapacity = ringSize;
+			ringHead = 0;
+			ringTail = 0;
+			ringBytesInUse = 0;
+		}
+
+		void destroy()
+		{
+			flush();
+			wait(lastSubmittedTicket);
+
+			for(VkFence fence : freeFences)
+			{
+				vkDestroyFence(device, fence, nullptr);
+			}
+			for(VkSemaphore semaphore : freeSemaphores)
+			{
+				vkDestroySemaphore(device, semaphore, nullptr);
+			}
+			freeFences.clear();
+			freeSemaphores.clear();
+
+			vkDestroyBuffer(device, ringBuffer, nullptr);
+			allocator->free(ringAllocation);
+
+			if(timestampPool != VK_NULL_HANDLE)
+			{
+				vkDestroyQueryPool(device, timestampPool, nullptr);
+			}
+
+			if(transferPool != graphicsPool)
+			{
+				vkDestroyCommandPool(device, transferPool, nullptr);
+			}
+			vkDestroyCommandPool(device, graphicsPool, nullptr);
+		}
+
+		bool hasDedicatedTransferQueue() const
+		{
+			return dedicatedTransfer;
+		}
+
+		//brackets every batch with gpu timestamps and reports them in ticks once the batch retires
+		//only done when the copies run on the graphics queue, transfer only queues cannot reset query pools
+		void enableTimestamps(std::function<void(uint64_t beginTicks, uint64_t endTicks)> callback)
+		{
+			if(dedicatedTransfer || timestampPool != VK_NULL_HANDLE)
+			{
+				return;
+			}
+
+			VkQueryPoolCreateInfo queryPoolInfo = {};
+			queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+			queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+			queryPoolInfo.queryCount = MAX_TIMED_BATCHES * 2;
+
+			if(vkCreateQueryPool(device, &queryPoolInfo, nullptr, &timestampPool) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create upload timestamp query pool!");
+			}
+
+			for(uint32_t i = 0; i < MAX_TIMED_BATCHES; i++)
+			{
+				freeTimestampPairs.push_back(i);
+			}
+			timestampCallback = std::move(callback);
+		}
+
+		//copies data into dstBuffer, dstStage and dstAccess describe the first use on the graphics queue
+		UploadTicket uploadBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+		{
+			const char* src = static_cast<const char*>(data);
+			VkDeviceSize maxChunk = ringCapacity / 2;
+
+			//every chunk is released on its own so a chunk landing in a later batch is still handed over correctly
+			for(VkDeviceSize done = 0; done < size;)
+			{
+				VkDeviceSize chunkSize = std::min(size - done, maxChunk);
+				VkDeviceSize stagingOffset = stage(src + done, chunkSize);
+				Batch& batch = openBatch();
+
+				VkBufferCopy copyRegion = {};
+				copyRegion.srcOffset = stagingOffset;
+				copyRegion.dstOffset = dstOffset + done;
+				copyRegion.size = chunkSize;
+				vkCmdCopyBuffer(batch.transferCommands, ringBuffer, dstBuffer, 1, &copyRegion);
+
+				releaseBuffer(batch, dstBuffer, dstOffset + done, chunkSize, dstStage, dstAccess);
+				done += chunkSize;
+			}
+
+			stats.bufferUploadCount++;
+			stats.bytesUploaded += size;
+			return openBatch().ticket;
+		}
+
+		//copies tightly packed texels into mip 0 of a colour image in UNDEFINED layout and leaves it in finalLayout
+		//large images are split into bands of whole rows
+		UploadTicket uploadImage(VkImage dstImage, uint32_t width, uint32_t height, const void* data, VkDeviceSize size, VkImageLayout finalLayout, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+		{
+			beginImageUpload(dstImage);
+			copyImageLevel(dstImage, 0, width, height, 1, static_cast<const char*>(data), size / height);
+			releaseImage(openBatch(), dstImage, finalLayout, dstStage, dstAccess);
+
+			stats.imageUploadCount++;
+			stats.bytesUploaded += size;
+			return openBatch().ticket;
+		}
+
+		//like uploadImage but data holds mipLevels levels packed one after another, each level half the size of the previous one rounded down
+		UploadTicket uploadImageMipChain(VkImage dstImage, uint32_t width, uint32_t height, uint32_t mipLevels, VkDeviceSize texelSize, const void* data, VkImageLayout finalLayout, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+		{
+			std::vector<const void*> levels(mipLevels);
+			const char* src = static_cast<const char*>(data);
+			for(uint32_t level = 0; level < mipLevels; level++)
+			{
+				levels[level] = src;
+				src += std::max(width >> level, 1u) * texelSize * std::max(height >> level, 1u);
+			}
+			return uploadImageLevels(dstImage, width, height, 1, texelSize, levels, finalLayout, dstStage, dstAccess);
+		}
+
+		//uploads levels that are already in the image's format, block compressed formats included
+		//levels[i] holds mip i as tightly packed rows of blockDim x blockDim texel blocks of blockSize bytes
+		UploadTicket uploadImageLevels(VkImage dstImage, uint32_t width, uint32_t height, uint32_t blockDim, VkDeviceSize blockSize, const std::vector<const void*>& levels, VkImageLayout finalLayout, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+		{
+			VkDeviceSize size = 0;
+			beginImageUpload(dstImage);
+			for(uint32_t level = 0; level < levels.size(); level++)
+			{
+				uint32_t levelWidth = std::max(width >> level, 1u);
+				uint32_t levelHeight = std::max(height >> level, 1u);
+				VkDeviceSize blockRowPitch = (levelWidth + blockDim - 1) / blockDim * blockSize;
+				copyImageLevel(dstImage, level, levelWidth, levelHeight, blockDim, static_cast<const char*>(levels[level]), blockRowPitch);
+				size += blockRowPitch * ((levelHeight + blockDim - 1) / blockDim);
+			}
+			releaseImage(openBatch(), dstImage, finalLayout, dstStage, dstAccess);
+
+			stats.imageUploadCount++;
+			stats.bytesUploaded += size;
+			return openBatch().ticket;
+		}
+
+		//copies mip 0 like uploadImage and fills the other mipLevels - 1 levels by repeatedly halving it with linear blits
+		//the blits need a graphics queue so they are recorded after the acquire, the format must support linear filtered blits
+		UploadTicket uploadImageGenerateMips(VkImage dstImage, uint32_t width, uint32_t height, uint32_t mipLevels, const void* data, VkDeviceSize size, VkImageLayout finalLayout, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+		{
+			beginImageUpload(dstImage);
+			copyImageLevel(dstImage, 0, width, height, 1, static_cast<const char*>(data), size / height);
+
+			//hands the whole image to the graphics queue still in TRANSFER_DST_OPTIMAL
+			Batch& batch = openBatch();
+			releaseImage(batch, dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT);
+
+			//every level is read once as the source of the next one and then moved to finalLayout on its own
+			VkCommandBuffer commands = batch.graphicsCommands;
+			int32_t levelWidth = static_cast<int32_t>(width);
+			int32_t levelHeight = static_cast<int32_t>(height);
+			for(uint32_t level = 1; level < mipLevels; level++)
+			{
+				VkImageMemoryBarrier barrier = imageBarrier(dstImage, level - 1, 1);
+				barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+				barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+				barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+				barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+				vkCmdPipelineBarrier(commands, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+				int32_t nextWidth = std::max(levelWidth / 2, 1);
+				int32_t nextHeight = std::max(levelHeight / 2, 1);
+
+				VkImageBlit blit = {};
+				blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				blit.srcSubresource.mipLevel = level - 1;
+				blit.srcSubresource.baseArrayLayer = 0;
+				blit.srcSubresource.layerCount = 1;
+				blit.srcOffsets[0] = {0, 0, 0};
+				blit.srcOffsets[1] = {levelWidth, levelHeight, 1};
+				blit.dstSubresource = blit.srcSubresource;
+				blit.dstSubresource.mipLevel = level;
+				blit.dstOffsets[0] = {0, 0, 0};
+				blit.dstOffsets[1] = {nextWidth, nextHeight, 1};
+				vkCmdBlitImage(commands, dstImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+				barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+				barrier.newLayout = finalLayout;
+				barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+				barrier.dstAccessMask = dstAccess;
+				vkCmdPipelineBarrier(commands, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+				levelWidth = nextWidth;
+				levelHeight = nextHeight;
+			}
+
+			//the last level was only ever written
+			VkImageMemoryBarrier barrier = imageBarrier(dstImage, mipLevels - 1, 1);
+			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.newLayout = finalLayout;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = dstAccess;
+			vkCmdPipelineBarrier(commands, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+			stats.imageUploadCount++;
+			stats.mipLevelsGenerated += mipLevels - 1;
+			stats.bytesUploaded += size;
+			return openBatch().ticket;
+		}
+
+		//graphics queue commands of the open batch, they run after every upload recorded so far has been acquired
+		VkCommandBuffer graphicsCommands()
+		{
+			return openBatch().graphicsCommands;
+		}
+
+		//runs once the batch holding the work recorded so far has completed on the gpu
+		void onComplete(std::function<void()> callback)
+		{
+			openBatch().callbacks.push_back(std::move(callback));
+		}
+
+		//submits the open batch, later graphics queue submissions are ordered after it without any cpu wait
+		UploadTicket flush()
+		{
+			if(!recording)
+			{
+				return lastSubmittedTicket;
+			}
+			Batch& batch = batches.back();
+
+			if(batch.timestampPair != NO_TIMESTAMPS)
+			{
+				vkCmdWriteTimestamp(batch.transferCommands, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampPool, batch.timestampPair * 2 + 1);
+			}
+
+			if(vkEndCommandBuffer(batch.transferCommands) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to record upload command buffer!");
+			}
+
+			VkSubmitInfo submitInfo = {};
+			submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			submitInfo.commandBufferCount = 1;
+			submitInfo.pCommandBuffers = &batch.transferCommands;
+
+			if(dedicatedTransfer)
+			{
+				if(vkEndCommandBuffer(batch.graphicsCommands) != VK_SUCCESS)
+				{
+					throw std::runtime_error("failed to record upload command buffer!");
+				}
+
+				submitInfo.signalSemaphoreCount = 1;
+				submitInfo.pSignalSemaphores = &batch.semaphore;
+				if(vkQueueSubmit(transferQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+				{
+					throw std::runtime_error("failed to submit upload command buffer!");
+				}
+
+				//the acquire barriers use the same stages as their source scope so they chain with this wait
+				VkPipelineStageFlags waitStage = batch.acquireStages != 0 ? batch.acquireStages : VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+				submitInfo = {};
+				submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+				submitInfo.waitSemaphoreCount = 1;
+				submitInfo.pWaitSemaphores = &batch.semaphore;
+				submitInfo.pWaitDstStageMask = &waitStage;
+				submitInfo.commandBufferCount = 1;
+				submitInfo.pCommandBuffers = &batch.graphicsCommands;
+				if(vkQueueSubmit(graphicsQueue, 1, &submitInfo, batch.fence) != VK_SUCCESS)
+				{
+					throw std::runtime_error("failed to submit upload command buffer!");
+				}
+			}
+			else
+			{
+				if(vkQueueSubmit(graphicsQueue, 1, &submitInfo, batch.fence) != VK_SUCCESS)
+				{
+					throw std::runtime_error("failed to submit upload command buffer!");
+				}
+			}
+
+			recording = false;
+			lastSubmittedTicket = batch.ticket;
+			stats.batchCount++;
+			return batch.ticket;
+		}
+
+		bool isComplete(UploadTicket ticket)
+		{
+			collect();
+			return ticket <= completedTicket;
+		}
+
+		//blocks until the batch with this ticket has completed, submitting it first if it is still open
+		void wait(UploadTicket ticket)
+		{
+			if(recording && ticket >= batches.back().ticket)
+			{
+				flush();
+			}
+
+			while(!batches.empty() && batches.front().ticket <= ticket)
+			{
+				stats.blockingWaitCount++;
+				vkWaitForFences(device, 1, &batches.front().fence, VK_TRUE, UINT64_MAX);
+				retireFront();
+			}
+		}
+
+		//releases everything owned by completed batches, cheap enough to call every frame
+		void collect()
+		{
+			while(!batches.empty() && !(recording && batches.size() == 1))
+			{
+				if(vkGetFenceStatus(device, batches.front().fence) != VK_SUCCESS)
+				{
+					break;
+				}
+				retireFront();
+			}
+		}
+
+		const UploadEngineStats& getStats() const
+		{
+			return stats;
+		}
+
+		void printStats(std::ostream& out) const
+		{
+			out << "upload engine (" << (dedicatedTransfer ? "dedicated transfer queue" : "graphics queue") << "):\n";
+			out << "\t  batches: " << stats.batchCount << ", buffers: " << stats.bufferUploadCount << ", images: " << stats.imageUploadCount << ", generated mip levels: " << stats.mipLevelsGenerated << "\n";
+			out << "\t  bytes uploaded: " << stats.bytesUploaded << ", blocking waits: " << stats.blockingWaitCount << "\n";
+			out << "\t  staging ring: " << ringCapacity / 1024 << " KiB, peak in use: " << stats.peakRingBytesInUse / 1024 << " KiB, chunks: " << stats.chunkCount << ", stalls: " << stats.ringStallCount << "\n";
+		}
+
+	private:
+		static const uint32_t MAX_TIMED_BATCHES = 16;
+		static const uint32_t NO_TIMESTAMPS = UINT32_MAX;
+
+		struct Batch
+		{
+			UploadTicket ticket = 0;
+			VkCommandBuffer transferCommands = VK_NULL_HANDLE;
+			VkCommandBuffer graphicsCommands = VK_NULL_HANDLE; //same as transferCommands without a dedicated transfer queue
+			VkSemaphore semaphore = VK_NULL_HANDLE;
+			VkFence fence = VK_NULL_HANDLE;
+			VkPipelineStageFlags acquireStages = 0;
+			VkDeviceSize ringEnd = 0; //ring head after this batch's last chunk, becomes the tail once it retires
+			VkDeviceSize ringBytes = 0; //including padding skipped when wrapping
+			uint32_t timestampPair = NO_TIMESTAMPS;
+			std::vector<std::function<void()>> callbacks;
+		};
+
+		VkDevice device;
+		MemoryAllocator* allocator;
+
+		uint32_t graphicsFamily;
+		uint32_t transferFamily;
+		VkQueue graphicsQueue;
+		VkQueue transferQueue;
+		bool dedicatedTransfer = false;
+
+		VkCommandPool graphicsPool = VK_NULL_HANDLE;
+		VkCommandPool transferPool = VK_NULL_HANDLE;
+
+		VkBuffer ringBuffer = VK_NULL_HANDLE;
+		Allocation ringAllocation;
+		VkDeviceSize ringCapacity = 0;
+		VkDeviceSize ringHead = 0;
+		VkDeviceSize ringTail = 0;
+		VkDeviceSize ringBytesInUse = 0;
+
+		//oldest batch at the front, while recording the open batch is at the back
+		std::deque<Batch> batches;
+		bool recording = false;
+		UploadTicket lastSubmittedTicket = 0;
+		UploadTicket completedTicket = 0;
+
+		std::vector<VkFence> freeFences;
+		std::vector<VkSemaphore> freeSemaphores;
+		std::vector<VkCommandBuffer> freeTransferCommands;
+		std::vector<VkCommandBuffer> freeGraphicsCommands;
+
+		VkQueryPool timestampPool = VK_NULL_HANDLE;
+		std::vector<uint32_t> freeTimestampPairs; //batches beyond these while many are in flight simply go untimed
+		std::function<void(uint64_t, uint64_t)> timestampCallback;
+
+		UploadEngineStats stats;
+
+		Batch& openBatch()
+		{
+			if(recording)
+			{
+				return batches.back();
+			}
+
+			Batch batch = {};
+			batch.ticket = lastSubmittedTicket + 1;
+			batch.fence = takeFence();
+			batch.transferCommands = takeCommandBuffer(transferPool, freeTransferCommands);
+			if(dedicatedTransfer)
+			{
+				batch.graphicsCommands = takeCommandBuffer(graphicsPool, freeGraphicsCommands);
+				batch.semaphore = takeSemaphore();
+			}
+			else
+			{
+				batch.graphicsCommands = batch.transferCommands;
+			}
+
+			if(!freeTimestampPairs.empty())
+			{
+				batch.timestampPair = freeTimestampPairs.back();
+				freeTimestampPairs.pop_back();
+				vkCmdResetQueryPool(batch.transferCommands, timestampPool, batch.timestampPair * 2, 2);
+				vkCmdWriteTimestamp(batch.transferCommands, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampPool, batch.timestampPair * 2);
+			}
+
+			batches.push_back(std::move(batch));
+			recording = true;
+			return batches.back();
+		}
+
+		//copies data into the staging ring and returns its offset, waits for the oldest batch while the ring is full
+		VkDeviceSize stage(const void* data, VkDeviceSize size)
+		{
+			VkDeviceSize offset;
+			while(!reserveRing(size, offset))
+			{
+				//the open batch may be the one holding the space
+				if(recording && batches.back().ringBytes > 0)
+				{
+					flush();
+				}
+				if(batches.empty() || (recording && batches.size() == 1))
+				{
+					throw std::runtime_error("upload does not fit into the staging ring!");
+				}
+
+				stats.ringStallCount++;
+				wait(batches.front().ticket);
+			}
+
+			memcpy(static_cast<char*>(ringAllocation.mapped) + offset, data, static_cast<size_t>(size));
+			stats.chunkCount++;
+			return offset;
+		}
+
+		bool reserveRing(VkDeviceSize size, VkDeviceSize& outOffset)
+		{
+			if(ringBytesInUse == 0)
+			{
+				ringHead = 0;
+				ringTail = 0;
+			}
+
+			VkDeviceSize start = (ringHead + RING_ALIGNMENT - 1) & ~(RING_ALIGNMENT - 1);
+			VkDeviceSize consumed;
+
+			if(ringHead > ringTail || ringBytesInUse == 0)
+			{
+				//free space is [head, capacity) followed by [0, tail)
+				if(start + size <= ringCapacity)
+				{
+					outOffset = start;
+					consumed = start + size - ringHead;
+				}
+				else if(size <= ringTail)
+				{
+					outOffset = 0;
+					consumed = ringCapacity - ringHead + size;
+				}
+				else
+				{
+					return false;
+				}
+			}
+			else
+			{
+				//wrapped, free space is [head, tail)
+				if(start + size > ringTail)
+				{
+					return false;
+				}
+				outOffset = start;
+				consumed = start + size - ringHead;
+			}
+
+			Batch& batch = openBatch();
+			ringHead = outOffset + size;
+			ringBytesInUse += consumed;
+			batch.ringBytes += consumed;
+			batch.ringEnd = ringHead;
+
+			stats.peakRingBytesInUse = std::max(stats.peakRingBytesInUse, ringBytesInUse);
+			return true;
+		}
+
+		//covers every mip level unless a range is given
+		VkImageMemoryBarrier imageBarrier(VkImage image, uint32_t baseMipLevel = 0, uint32_t levelCount = VK_REMAINING_MIP_LEVELS)
+		{
+			VkImageMemoryBarrier barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = image;
+			barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			barrier.subresourceRange.baseMipLevel = baseMipLevel;
+			barrier.subresourceRange.levelCount = levelCount;
+			barrier.subresourceRange.baseArrayLayer = 0;
+			barrier.subresourceRange.layerCount = 1;
+			return barrier;
+		}
+
+		//moves every level of an image in UNDEFINED layout to TRANSFER_DST_OPTIMAL
+		void beginImageUpload(VkImage image)
+		{
+			VkImageMemoryBarrier barrier = imageBarrier(image);
+			barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			vkCmdPipelineBarrier(openBatch().transferCommands, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+		}
+
+		//stages one level in bands of whole block rows, the bands write disjoint rows so they need no barriers between them
+		//a row is blockDim texels high, rowPitch is the size of one row of blocks
+		void copyImageLevel(VkImage image, uint32_t level, uint32_t width, uint32_t height, uint32_t blockDim, const char* src, VkDeviceSize rowPitch)
+		{
+			uint32_t blockRows = (height + blockDim - 1) / blockDim;
+			uint32_t rowsPerChunk = static_cast<uint32_t>(std::min<VkDeviceSize>(blockRows, (ringCapacity / 2) / rowPitch));
+			if(rowsPerChunk == 0)
+			{
+				throw std::runtime_error("image row does not fit into the staging ring!");
+			}
+
+			for(uint32_t blockRow = 0; blockRow < blockRows; blockRow += rowsPerChunk)
+			{
+				uint32_t rows = std::min(rowsPerChunk, blockRows - blockRow);
+				VkDeviceSize stagingOffset = stage(src + blockRow * rowPitch, rows * rowPitch);
+				Batch& batch = openBatch();
+
+				VkBufferImageCopy region = {};
+				region.bufferOffset = stagingOffset;
+				region.bufferRowLength = 0;
+				region.bufferImageHeight = 0;
+				region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				region.imageSubresource.mipLevel = level;
+				region.imageSubresource.baseArrayLayer = 0;
+				region.imageSubresource.layerCount = 1;
+				//the last band of a block compressed level ends at the image edge, not on a block boundary
+				uint32_t row = blockRow * blockDim;
+				region.imageOffset = {0, static_cast<int32_t>(row), 0};
+				region.imageExtent = {width, std::min(rows * blockDim, height - row), 1};
+				vkCmdCopyBufferToImage(batch.transferCommands, ringBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+			}
+		}
+
+		//makes the transfer writes visible to dstStage on the graphics queue, handing ownership over if the queues differ
+		void releaseBuffer(Batch& batch, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+		{
+			VkBufferMemoryBarrier barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.buffer = buffer;
+			barrier.offset = offset;
+			barrier.size = size;
+
+			if(dedicatedTransfer)
+			{
+				//release on the transfer queue, the destination access is ignored for a release
+				barrier.srcQueueFamilyIndex = transferFamily;
+				barrier.dstQueueFamilyIndex = graphicsFamily;
+				barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+				barrier.dstAccessMask = 0;
+				vkCmdPipelineBarrier(batch.transferCommands, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+				//matching acquire on the graphics queue, made available by the semaphore so no source access is needed
+				barrier.srcAccessMask = 0;
+				barrier.dstAccessMask = dstAccess;
+				vkCmdPipelineBarrier(batch.graphicsCommands, dstStage, dstStage, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+				batch.acquireStages |= dstStage;
+			}
+			else
+			{
+				barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+				barrier.dstAccessMask = dstAccess;
+				vkCmdPipelineBarrier(batch.transferCommands, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+			}
+		}
+
+		//the layout transition happens once, as part of the release/acquire pair when ownership moves
+		void releaseImage(Batch& batch, VkImage image, VkImageLayout finalLayout, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+		{
+			VkImageMemoryBarrier barrier = imageBarrier(image);
+			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.newLayout = finalLayout;
+
+			if(dedicatedTransfer)
+			{
+				barrier.srcQueueFamilyIndex = transferFamily;
+				barrier.dstQueueFamilyIndex = graphicsFamily;
+				barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+				barrier.dstAccessMask = 0;
+				vkCmdPipelineBarrier(batch.transferCommands, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+				barrier.srcAccessMask = 0;
+				barrier.dstAccessMask = dstAccess;
+				vkCmdPipelineBarrier(batch.graphicsCommands, dstStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+				batch.acquireStages |= dstStage;
+			}
+			else
+			{
+				barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+				barrier.dstAccessMask = dstAccess;
+				vkCmdPipelineBarrier(batch.transferCommands, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+			}
+		}
+
+		void retireFront()
+		{
+			Batch& batch = batches.front();
+
+			for(auto& callback : batch.callbacks)
+			{
+				callback();
+			}
+			if(batch.timestampPair != NO_TIMESTAMPS)
+			{
+				uint64_t ticks[2];
+				if(vkGetQueryPoolResults(device, timestampPool, batch.timestampPair * 2, 2, sizeof(ticks), ticks, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+				{
+					timestampCallback(ticks[0], ticks[1]);
+				}
+				freeTimestampPairs.push_back(batch.timestampPair);
+			}
+			if(batch.ringBytes > 0)
+			{
+				ringTail = batch.ringEnd;
+				ringBytesInUse -= batch.ringBytes;
+			}
+
+			vkResetFences(device, 1, &batch.fence);
+			freeFences.push_back(batch.fence);
+			vkResetCommandBuffer(batch.transferCommands, 0);
+			freeTransferCommands.push_back(batch.transferCommands);
+			if(dedicatedTransfer)
+			{
+				vkResetCommandBuffer(batch.graphicsCommands, 0);
+				freeGraphicsCommands.push_back(batch.graphicsCommands);
+				freeSemaphores.push_back(batch.semaphore);
+			}
+
+			completedTicket = batch.ticket;
+			batches.pop_front();
+		}
+
+		VkFence takeFence()
+		{
+			if(!freeFences.empty())
+			{
+				VkFence fence = freeFences.back();
+				freeFences.pop_back();
+				return fence;
+			}
+
+			VkFenceCreateInfo fenceInfo = {};
+			fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+			VkFence fence;
+			if(vkCreateFence(device, &fenceInfo, nullptr, &fence) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create upload fence!");
+			}
+			return fence;
+		}
+
+		VkSemaphore takeSemaphore()
+		{
+			if(!freeSemaphores.empty())
+			{
+				VkSemaphore semaphore = freeSemaphores.back();
+				freeSemaphores.pop_back();
+				return semaphore;
+			}
+
+			VkSemaphoreCreateInfo semaphoreInfo = {};
+			semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+			VkSemaphore semaphore;
+			if(vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create upload semaphore!");
+			}
+			return semaphore;
+		}
+
+		//command buffers are recycled instead of freed, they are reset when their batch retires
+		VkCommandBuffer takeCommandBuffer(VkCommandPool pool, std::vector<VkCommandBuffer>& freeList)
+		{
+			VkCommandBuffer commandBuffer;
+			if(!freeList.empty())
+			{
+				commandBuffer = freeList.back();
+				freeList.pop_back();
+			}
+			else
+			{
+				VkCommandBufferAllocateInfo allocInfo = {};
+				allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+				allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+				allocInfo.commandPool = pool;
+				allocInfo.commandBufferCount = 1;
+
+				if(vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS)
+				{
+					throw std::runtime_error("failed to allocate upload command buffer!");
+				}
+			}
+
+			VkCommandBufferBeginInfo beginInfo = {};
+			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+			if(vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to begin recording upload command buffer!");
+			}
+			return commandBuffer;
+		}
+};
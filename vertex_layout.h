@@ -0,0 +1,351 @@
+#pragma once
+
+#include "pch.h"
+
+#include <vulkan/vulkan.h>
+
+#include <cmath>
+
+//vertex input locations the shaders read, whichever layout the vertices are stored in
+enum VertexLocation : uint32_t
+{
+	VERTEX_LOCATION_POSITION = 0,
+	VERTEX_LOCATION_COLOR = 1,
+	VERTEX_LOCATION_TEXCOORD = 2,
+	VERTEX_LOCATION_COUNT
+};
+
+enum VertexAttributeFormat : uint32_t
+{
+	VERTEX_FORMAT_FLOAT2,
+	VERTEX_FORMAT_FLOAT3,
+	//positions relative to the mesh bounds, the fourth component is padding since three 16 bit components are rarely fetchable
+	VERTEX_FORMAT_SNORM16X4,
+	//colours, alpha is always 1
+	VERTEX_FORMAT_UNORM8X4,
+	VERTEX_FORMAT_HALF2
+};
+
+struct VertexAttributeFormatInfo
+{
+	VkFormat format;
+	uint32_t size;
+};
+
+inline VertexAttributeFormatInfo getVertexAttributeFormatInfo(VertexAttributeFormat format)
+{
+	switch(format)
+	{
+		case VERTEX_FORMAT_FLOAT2: return {VK_FORMAT_R32G32_SFLOAT, 8};
+		case VERTEX_FORMAT_FLOAT3: return {VK_FORMAT_R32G32B32_SFLOAT, 12};
+		case VERTEX_FORMAT_SNORM16X4: return {VK_FORMAT_R16G16B16A16_SNORM, 8};
+		case VERTEX_FORMAT_UNORM8X4: return {VK_FORMAT_R8G8B8A8_UNORM, 4};
+		case VERTEX_FORMAT_HALF2: return {VK_FORMAT_R16G16_SFLOAT, 4};
+	}
+	throw std::runtime_error("unknown vertex attribute format!");
+}
+
+//float is the interleaved 32 byte vertex the mesh files store, split moves the positions into a stream of their own,
+//packed splits the same way and quantizes positions to 16 bit snorm, colours to 8 bit unorm and texture coordinates to half floats
+enum VertexLayoutPreset : uint32_t
+{
+	VERTEX_LAYOUT_FLOAT,
+	VERTEX_LAYOUT_SPLIT,
+	VERTEX_LAYOUT_PACKED,
+	VERTEX_LAYOUT_COUNT
+};
+
+inline const char* getVertexLayoutName(VertexLayoutPreset preset)
+{
+	static const char* names[VERTEX_LAYOUT_COUNT] = {"float", "split", "packed"};
+	return names[preset];
+}
+
+//returns false for an unknown name
+inline bool parseVertexLayout(const std::string& name, VertexLayoutPreset& preset)
+{
+	for(uint32_t i = 0; i < VERTEX_LAYOUT_COUNT; i++)
+	{
+		if(name == getVertexLayoutName(static_cast<VertexLayoutPreset>(i)))
+		{
+			preset = static_cast<VertexLayoutPreset>(i);
+			return true;
+		}
+	}
+	return false;
+}
+
+//interleaved float vertices every layout is packed from, float3 position and colour and float2 texture coordinate
+struct VertexSource
+{
+	const void* data;
+	uint32_t count;
+	uint32_t stride;
+	uint32_t positionOffset;
+	uint32_t colorOffset;
+	uint32_t texCoordOffset;
+	float boundsMin[3];
+	float boundsMax[3];
+};
+
+//describes which stream and format every vertex attribute is stored in and generates the pipeline's vertex input state
+//the streams are stored one after another in a single buffer, stream 0 always starts with the positions
+class VertexLayout
+{
+	public:
+		static const uint32_t MAX_STREAMS = 2;
+		static const VkDeviceSize STREAM_ALIGNMENT = 16;
+
+		//formatSupported tells whether a VkFormat can be fetched from a vertex buffer, unsupported packed formats fall back to floats
+		template<typename FormatSupported>
+		void init(VertexLayoutPreset preset, FormatSupported formatSupported)
+		{
+			this->preset = preset;
+			attributes.clear();
+			streamStrides.fill(0);
+			streamCount = 0;
+
+			bool split = preset != VERTEX_LAYOUT_FLOAT;
+			bool packed = preset == VERTEX_LAYOUT_PACKED;
+			auto pick = [&](VertexAttributeFormat packedFormat, VertexAttributeFormat floatFormat)
+			{
+				return packed && formatSupported(getVertexAttributeFormatInfo(packedFormat).format) ? packedFormat : floatFormat;
+			};
+
+			addAttribute(VERTEX_LOCATION_POSITION, pick(VERTEX_FORMAT_SNORM16X4, VERTEX_FORMAT_FLOAT3), 0);
+			addAttribute(VERTEX_LOCATION_COLOR, pick(VERTEX_FORMAT_UNORM8X4, VERTEX_FORMAT_FLOAT3), split ? 1 : 0);
+			addAttribute(VERTEX_LOCATION_TEXCOORD, pick(VERTEX_FORMAT_HALF2, VERTEX_FORMAT_FLOAT2), split ? 1 : 0);
+		}
+
+		VertexLayoutPreset getPreset() const
+		{
+			return preset;
+		}
+
+		uint32_t getStreamCount() const
+		{
+			return streamCount;
+		}
+
+		uint32_t getStride(uint32_t stream) const
+		{
+			return streamStrides[stream];
+		}
+
+		//bytes one vertex takes over all streams
+		uint32_t getVertexSize() const
+		{
+			uint32_t size = 0;
+			for(uint32_t stream = 0; stream < streamCount; stream++)
+			{
+				size += streamStrides[stream];
+			}
+			return size;
+		}
+
+		//offset of every stream in a buffer holding vertexCount vertices
+		std::vector<VkDeviceSize> getStreamOffsets(uint32_t vertexCount) const
+		{
+			std::vector<VkDeviceSize> offsets(streamCount);
+			VkDeviceSize offset = 0;
+			for(uint32_t stream = 0; stream < streamCount; stream++)
+			{
+				offsets[stream] = offset;
+				offset = alignStream(offset + static_cast<VkDeviceSize>(streamStrides[stream]) * vertexCount);
+			}
+			return offsets;
+		}
+
+		VkDeviceSize getBufferSize(uint32_t vertexCount) const
+		{
+			return getStreamOffsets(vertexCount).back() + static_cast<VkDeviceSize>(streamStrides[streamCount - 1]) * vertexCount;
+		}
+
+		//positionOnly describes the bindings a depth only pass needs, just stream 0 and the position attribute
+		std::vector<VkVertexInputBindingDescription> getBindingDescriptions(bool positionOnly = false) const
+		{
+			std::vector<VkVertexInputBindingDescription> bindings;
+			for(uint32_t stream = 0; stream < (positionOnly ? 1 : streamCount); stream++)
+			{
+				VkVertexInputBindingDescription binding = {};
+				binding.binding = stream;
+				binding.stride = streamStrides[stream];
+				binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+				bindings.push_back(binding);
+			}
+			return bindings;
+		}
+
+		std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions(bool positionOnly = false) const
+		{
+			std::vector<VkVertexInputAttributeDescription> descriptions;
+			for(const Attribute& attribute : attributes)
+			{
+				if(positionOnly && attribute.location != VERTEX_LOCATION_POSITION)
+				{
+					continue;
+				}
+				VkVertexInputAttributeDescription description = {};
+				description.location = attribute.location;
+				description.binding = attribute.stream;
+				description.format = getVertexAttributeFormatInfo(attribute.format).format;
+				description.offset = attribute.offset;
+				descriptions.push_back(description);
+			}
+			return descriptions;
+		}
+
+		//true when the layout stores vertices exactly like source, so they can be uploaded without packing
+		bool matchesSource(const VertexSource& source) const
+		{
+			const Attribute& position = attributes[VERTEX_LOCATION_POSITION];
+			const Attribute& color = attributes[VERTEX_LOCATION_COLOR];
+			const Attribute& texCoord = attributes[VERTEX_LOCATION_TEXCOORD];
+			return streamCount == 1 && streamStrides[0] == source.stride
+				&& position.format == VERTEX_FORMAT_FLOAT3 && position.offset == source.positionOffset
+				&& color.format == VERTEX_FORMAT_FLOAT3 && color.offset == source.colorOffset
+				&& texCoord.format == VERTEX_FORMAT_FLOAT2 && texCoord.offset == source.texCoordOffset;
+		}
+
+		//quantized positions are stored as (position - offset) / scale per axis, the vertex transform has to undo it
+		void getPositionDequantize(const VertexSource& source, float scale[3], float offset[3]) const
+		{
+			bool quantized = attributes[VERTEX_LOCATION_POSITION].format == VERTEX_FORMAT_SNORM16X4;
+			for(int axis = 0; axis < 3; axis++)
+			{
+				float halfExtent = (source.boundsMax[axis] - source.boundsMin[axis]) * 0.5f;
+				scale[axis] = quantized && halfExtent > 0.0f ? halfExtent : 1.0f;
+				offset[axis] = quantized ? (source.boundsMin[axis] + source.boundsMax[axis]) * 0.5f : 0.0f;
+			}
+		}
+
+		//writes every vertex of source into out, laid out as getStreamOffsets describes
+		void pack(const VertexSource& source, std::vector<uint8_t>& out) const
+		{
+			float scale[3];
+			float offset[3];
+			getPositionDequantize(source, scale, offset);
+
+			std::vector<VkDeviceSize> streamOffsets = getStreamOffsets(source.count);
+			out.assign(static_cast<size_t>(getBufferSize(source.count)), 0);
+
+			const uint8_t* src = static_cast<const uint8_t*>(source.data);
+			for(uint32_t i = 0; i < source.count; i++)
+			{
+				const uint8_t* vertex = src + static_cast<size_t>(i) * source.stride;
+				for(const Attribute& attribute : attributes)
+				{
+					float values[3];
+					uint32_t componentCount = attribute.location == VERTEX_LOCATION_TEXCOORD ? 2 : 3;
+					uint32_t sourceOffset = attribute.location == VERTEX_LOCATION_POSITION ? source.positionOffset : attribute.location == VERTEX_LOCATION_COLOR ? source.colorOffset : source.texCoordOffset;
+					memcpy(values, vertex + sourceOffset, componentCount * sizeof(float));
+					if(attribute.location == VERTEX_LOCATION_POSITION)
+					{
+						for(int axis = 0; axis < 3; axis++)
+						{
+							values[axis] = (values[axis] - offset[axis]) / scale[axis];
+						}
+					}
+
+					uint8_t* dst = out.data() + streamOffsets[attribute.stream] + static_cast<size_t>(i) * streamStrides[attribute.stream] + attribute.offset;
+					writeAttribute(attribute.format, values, componentCount, dst);
+				}
+			}
+		}
+
+	private:
+		struct Attribute
+		{
+			uint32_t location;
+			VertexAttributeFormat format;
+			uint32_t stream;
+			uint32_t offset;
+		};
+
+		VertexLayoutPreset preset = VERTEX_LAYOUT_FLOAT;
+		//indexed by location
+		std::vector<Attribute> attributes;
+		std::array<uint32_t, MAX_STREAMS> streamStrides = {};
+		uint32_t streamCount = 0;
+
+		static VkDeviceSize alignStream(VkDeviceSize offset)
+		{
+			return (offset + STREAM_ALIGNMENT - 1) & ~(STREAM_ALIGNMENT - 1);
+		}
+
+		//attributes are appended to their stream in location order, every format is 4 byte aligned already
+		void addAttribute(VertexLocation location, VertexAttributeFormat format, uint32_t stream)
+		{
+			attributes.push_back({location, format, stream, streamStrides[stream]});
+			streamStrides[stream] += getVertexAttributeFormatInfo(format).size;
+			streamCount = std::max(streamCount, stream + 1);
+		}
+
+		//round to nearest even, denormals flush to zero and values past the half range become infinity
+		static uint16_t floatToHalf(float value)
+		{
+			uint32_t bits;
+			memcpy(&bits, &value, sizeof(bits));
+			uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+			int32_t exponent = static_cast<int32_t>((bits >> 23) & 0xff) - 127 + 15;
+			uint32_t mantissa = bits & 0x7fffff;
+
+			if(((bits >> 23) & 0xff) == 0xff)
+			{
+				return static_cast<uint16_t>(sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0));
+			}
+			if(exponent <= 0)
+			{
+				return sign;
+			}
+
+			uint32_t half = (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+			uint32_t remainder = mantissa & 0x1fff;
+			if(remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+			{
+				half++;
+			}
+			if(half >= 0x7c00)
+			{
+				return static_cast<uint16_t>(sign | 0x7c00);
+			}
+			return static_cast<uint16_t>(sign | half);
+		}
+
+		static void writeAttribute(VertexAttributeFormat format, const float* values, uint32_t componentCount, uint8_t* dst)
+		{
+			switch(format)
+			{
+				case VERTEX_FORMAT_FLOAT2:
+				case VERTEX_FORMAT_FLOAT3:
+					memcpy(dst, values, componentCount * sizeof(float));
+					break;
+				case VERTEX_FORMAT_SNORM16X4:
+				{
+					int16_t packed[4] = {0, 0, 0, 0};
+					for(uint32_t i = 0; i < componentCount; i++)
+					{
+						packed[i] = static_cast<int16_t>(std::lround(std::min(std::max(values[i], -1.0f), 1.0f) * 32767.0f));
+					}
+					memcpy(dst, packed, sizeof(packed));
+					break;
+				}
+				case VERTEX_FORMAT_UNORM8X4:
+				{
+					uint8_t packed[4] = {0, 0, 0, 255};
+					for(uint32_t i = 0; i < componentCount; i++)
+					{
+						packed[i] = static_cast<uint8_t>(std::lround(std::min(std::max(values[i], 0.0f), 1.0f) * 255.0f));
+					}
+					memcpy(dst, packed, sizeof(packed));
+					break;
+				}
+				case VERTEX_FORMAT_HALF2:
+				{
+					uint16_t packed[2] = {floatToHalf(values[0]), floatToHalf(values[1])};
+					memcpy(dst, packed, sizeof(packed));
+					break;
+				}
+			}
+		}
+};